@@ -6,21 +6,37 @@ HEADERS       = includes/qst/window.h \
                 includes/platforms/linux/posixUtils.hpp \
                 includes/qst/processcontroller.h \
                 includes/qst/processmonitor.hpp \
+                includes/qst/quantilesketch.hpp \
+                includes/qst/rateestimator.hpp \
                 includes/qst/platforms.hpp \
+                includes/qst/plotrasterizer.h \
                 includes/qst/apihandler.hpp \
+                includes/qst/historylog.h \
+                includes/qst/jsonstreamreader.hpp \
+                includes/qst/keyedmenu.hpp \
+                includes/qst/lttb.hpp \
+                includes/qst/slidingwindow.hpp \
                 includes/qst/startuptab.hpp \
+                includes/qst/statshistory.hpp \
+                includes/qst/statsplot.hpp \
                 includes/qst/statswidget.h \
+                includes/qst/synccompletion.hpp \
                 includes/qst/syncwebview.h \
                 includes/qst/syncwebpage.h \
+                includes/qst/timeseries.hpp \
+                includes/qst/transferattribution.hpp \
+                includes/qst/trayiconcache.hpp \
                 includes/qst/utilities.hpp \
                 includes/qst/updatenotifier.h \
                 includes/contrib/qcustomplot.h
 SOURCES       = sources/qst/main.cpp \
+                sources/qst/historylog.cpp \
                 sources/qst/window.cpp \
                 sources/qst/syncconnector.cpp \
                 sources/qst/processcontroller.cpp \
                 sources/qst/processmonitor.cpp \
                 sources/qst/startuptab.cpp \
+                sources/qst/plotrasterizer.cpp \
                 sources/qst/statswidget.cpp \
                 sources/qst/syncwebview.cpp \
                 sources/qst/syncwebpage.cpp \
@@ -35,6 +51,8 @@ QT += widgets
 QT += network
 QT += webenginewidgets
 QT += printsupport
+# only the QCustomPlot parts used by the stats plots
+DEFINES += QCUSTOMPLOT_SLIM
 INCLUDEPATH += $$PWD/includes/
 # install
 target.path = binary/
@@ -44,6 +44,20 @@
   #define QCP_DEVICEPIXELRATIO_SUPPORTED
 #endif
 
+// feature switches to compile out plottables, items and tickers that are not used. Each QCP_NO_*
+// can be defined on its own, QCUSTOMPLOT_SLIM defines all of them and keeps QCPGraph,
+// QCPItemText, QCPAxisTickerDateTime, the text element and the legend:
+#ifdef QCUSTOMPLOT_SLIM
+#  define QCP_NO_CURVE
+#  define QCP_NO_BARS
+#  define QCP_NO_STATISTICALBOX
+#  define QCP_NO_COLORMAP // color map, color scale and color gradient
+#  define QCP_NO_FINANCIAL
+#  define QCP_NO_ERRORBARS
+#  define QCP_NO_EXTRA_ITEMS // all items except QCPItemText
+#  define QCP_NO_EXTRA_TICKERS // all tickers except QCPAxisTickerDateTime
+#endif
+
 #include <QtCore/QObject>
 #include <QtCore/QPointer>
 #include <QtCore/QSharedPointer>
@@ -530,6 +544,7 @@ public:
   virtual void donePainting() {}
   virtual void draw(QCPPainter *painter) const = 0;
   virtual void clear(const QColor &color) = 0;
+  virtual bool scroll(int dx, int dy, const QRect &rect);
   
 protected:
   // property members:
@@ -564,6 +579,30 @@ protected:
 };
 
 
+class QCP_LIB_DECL QCPPaintBufferImage : public QCPAbstractPaintBuffer
+{
+public:
+  explicit QCPPaintBufferImage(const QSize &size, double devicePixelRatio);
+  virtual ~QCPPaintBufferImage();
+  
+  // getters:
+  QImage image() const { return mBuffer; }
+  
+  // reimplemented virtual methods:
+  virtual QCPPainter *startPainting() Q_DECL_OVERRIDE;
+  virtual void draw(QCPPainter *painter) const Q_DECL_OVERRIDE;
+  void clear(const QColor &color) Q_DECL_OVERRIDE;
+  virtual bool scroll(int dx, int dy, const QRect &rect) Q_DECL_OVERRIDE;
+  
+protected:
+  // non-property members:
+  QImage mBuffer;
+  
+  // reimplemented virtual methods:
+  virtual void reallocateBuffer() Q_DECL_OVERRIDE;
+};
+
+
 #ifdef QCP_OPENGL_PBUFFER
 class QCP_LIB_DECL QCPPaintBufferGlPbuffer : public QCPAbstractPaintBuffer
 {
@@ -652,6 +691,7 @@ public:
   QList<QCPLayerable*> children() const { return mChildren; }
   bool visible() const { return mVisible; }
   LayerMode mode() const { return mMode; }
+  quint64 repaintCount() const { return mRepaintCount; }
   
   // setters:
   void setVisible(bool visible);
@@ -671,6 +711,7 @@ protected:
   
   // non-property members:
   QWeakPointer<QCPAbstractPaintBuffer> mPaintBuffer;
+  quint64 mRepaintCount;
   
   // non-virtual methods:
   void draw(QCPPainter *painter);
@@ -1607,6 +1648,7 @@ protected:
 /* end of 'src/axis/axistickerdatetime.h' */
 
 
+#ifndef QCP_NO_EXTRA_TICKERS
 /* including file 'src/axis/axistickertime.h', size 3288                     */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -1657,8 +1699,10 @@ protected:
 Q_DECLARE_METATYPE(QCPAxisTickerTime::TimeUnit)
 
 /* end of 'src/axis/axistickertime.h' */
+#endif // QCP_NO_EXTRA_TICKERS
 
 
+#ifndef QCP_NO_EXTRA_TICKERS
 /* including file 'src/axis/axistickerfixed.h', size 3308                    */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -1699,8 +1743,10 @@ protected:
 Q_DECLARE_METATYPE(QCPAxisTickerFixed::ScaleStrategy)
 
 /* end of 'src/axis/axistickerfixed.h' */
+#endif // QCP_NO_EXTRA_TICKERS
 
 
+#ifndef QCP_NO_EXTRA_TICKERS
 /* including file 'src/axis/axistickertext.h', size 3085                     */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -1738,8 +1784,10 @@ protected:
 };
 
 /* end of 'src/axis/axistickertext.h' */
+#endif // QCP_NO_EXTRA_TICKERS
 
 
+#ifndef QCP_NO_EXTRA_TICKERS
 /* including file 'src/axis/axistickerpi.h', size 3911                       */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -1797,8 +1845,10 @@ protected:
 Q_DECLARE_METATYPE(QCPAxisTickerPi::FractionStyle)
 
 /* end of 'src/axis/axistickerpi.h' */
+#endif // QCP_NO_EXTRA_TICKERS
 
 
+#ifndef QCP_NO_EXTRA_TICKERS
 /* including file 'src/axis/axistickerlog.h', size 2663                      */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -1830,6 +1880,7 @@ protected:
 };
 
 /* end of 'src/axis/axistickerlog.h' */
+#endif // QCP_NO_EXTRA_TICKERS
 
 
 /* including file 'src/axis/axis.h', size 20230                              */
@@ -2370,6 +2421,23 @@ Q_DECLARE_METATYPE(QCPScatterStyle::ScatterShape)
 template <class DataType>
 inline bool qcpLessThanSortKey(const DataType &a, const DataType &b) { return a.sortKey() < b.sortKey(); }
 
+/*! \internal
+
+  Hook for data types that provide a faster, e.g. vectorized, search of the value range of the
+  points in [\a begin, \a end), ignoring NaN values. Returns false if the data type has no such
+  search, in which case \ref QCPDataContainer::valueRange uses its generic loop. See the overload
+  for \ref QCPGraphData.
+*/
+template <class DataType>
+inline bool qcpFindValueRange(const DataType *begin, const DataType *end, QCPRange &range, bool &foundRange)
+{
+  Q_UNUSED(begin)
+  Q_UNUSED(end)
+  Q_UNUSED(range)
+  Q_UNUSED(foundRange)
+  return false;
+}
+
 template <class DataType>
 class QCP_LIB_DECL QCPDataContainer
 {
@@ -2383,9 +2451,11 @@ public:
   int size() const { return mData.size()-mPreallocSize; }
   bool isEmpty() const { return size() == 0; }
   bool autoSqueeze() const { return mAutoSqueeze; }
+  int capacity() const { return mCapacity; }
   
   // setters:
   void setAutoSqueeze(bool enabled);
+  void setCapacity(int capacity);
   
   // non-virtual methods:
   void set(const QCPDataContainer<DataType> &data);
@@ -2416,6 +2486,7 @@ public:
 protected:
   // property members:
   bool mAutoSqueeze;
+  int mCapacity;
   
   // non-property memebers:
   QVector<DataType> mData;
@@ -2425,6 +2496,8 @@ protected:
   // non-virtual methods:
   void preallocateGrow(int minimumPreallocSize);
   void performAutoSqueeze();
+  void prepareBoundedAppend(int n);
+  void enforceCapacity();
 };
 
 // include implementation in header since it is a class template:
@@ -2568,6 +2641,7 @@ protected:
 template <class DataType>
 QCPDataContainer<DataType>::QCPDataContainer() :
   mAutoSqueeze(true),
+  mCapacity(0),
   mPreallocSize(0),
   mPreallocIteration(0)
 {
@@ -2592,6 +2666,36 @@ void QCPDataContainer<DataType>::setAutoSqueeze(bool enabled)
   }
 }
 
+/*!
+  Switches the container to bounded mode holding at most \a capacity data points, or back to the
+  default growing mode if \a capacity is 0.
+
+  Bounded mode is meant for streaming data that is appended at the end and expired at the front
+  (\ref removeBefore). The storage is allocated once with room for twice the capacity and used like
+  a ring: expired points only move the begin of the container, and when the end of the storage is
+  reached the remaining points are moved back to its start within the same allocation. Appending
+  beyond the capacity drops the oldest points. Iterators stay plain pointers into contiguous
+  memory, so plottables and \ref findBegin / \ref findEnd work unchanged. Auto squeeze is not
+  performed in bounded mode.
+
+  As with any modification, iterators are invalidated by appending in bounded mode.
+*/
+template <class DataType>
+void QCPDataContainer<DataType>::setCapacity(int capacity)
+{
+  capacity = qMax(0, capacity);
+  if (mCapacity == capacity)
+    return;
+  mCapacity = capacity;
+  if (mCapacity > 0)
+  {
+    enforceCapacity();
+    squeeze(true, false); // moves the remaining points to the start of the storage
+    mData.reserve(2*mCapacity);
+  } else if (mAutoSqueeze)
+    performAutoSqueeze();
+}
+
 /*! \overload
   
   Replaces the current data in this container with the provided \a data.
@@ -2617,11 +2721,17 @@ void QCPDataContainer<DataType>::set(const QCPDataContainer<DataType> &data)
 template <class DataType>
 void QCPDataContainer<DataType>::set(const QVector<DataType> &data, bool alreadySorted)
 {
-  mData = data;
+  if (mCapacity > 0) // copy into the existing storage instead of sharing the one of data
+  {
+    mData.resize(data.size());
+    std::copy(data.constBegin(), data.constEnd(), mData.begin());
+  } else
+    mData = data;
   mPreallocSize = 0;
   mPreallocIteration = 0;
   if (!alreadySorted)
     sort();
+  enforceCapacity();
 }
 
 /*! \overload
@@ -2647,11 +2757,13 @@ void QCPDataContainer<DataType>::add(const QCPDataContainer<DataType> &data)
     std::copy(data.constBegin(), data.constEnd(), begin());
   } else // don't need to prepend, so append and merge if necessary
   {
+    prepareBoundedAppend(n);
     mData.resize(mData.size()+n);
     std::copy(data.constBegin(), data.constEnd(), end()-n);
     if (oldSize > 0 && !qcpLessThanSortKey<DataType>(*(constEnd()-n-1), *(constEnd()-n))) // if appended range keys aren't all greater than existing ones, merge the two partitions
       std::inplace_merge(begin(), end()-n, end(), qcpLessThanSortKey<DataType>);
   }
+  enforceCapacity();
 }
 
 /*!
@@ -2684,6 +2796,7 @@ void QCPDataContainer<DataType>::add(const QVector<DataType> &data, bool already
     std::copy(data.constBegin(), data.constEnd(), begin());
   } else // don't need to prepend, so append and then sort and merge if necessary
   {
+    prepareBoundedAppend(n);
     mData.resize(mData.size()+n);
     std::copy(data.constBegin(), data.constEnd(), end()-n);
     if (!alreadySorted) // sort appended subrange if it wasn't already sorted
@@ -2691,6 +2804,7 @@ void QCPDataContainer<DataType>::add(const QVector<DataType> &data, bool already
     if (oldSize > 0 && !qcpLessThanSortKey<DataType>(*(constEnd()-n-1), *(constEnd()-n))) // if appended range keys aren't all greater than existing ones, merge the two partitions
       std::inplace_merge(begin(), end()-n, end(), qcpLessThanSortKey<DataType>);
   }
+  enforceCapacity();
 }
 
 /*! \overload
@@ -2704,6 +2818,7 @@ void QCPDataContainer<DataType>::add(const DataType &data)
 {
   if (isEmpty() || !qcpLessThanSortKey<DataType>(data, *(constEnd()-1))) // quickly handle appends if new data key is greater or equal to existing ones
   {
+    prepareBoundedAppend(1);
     mData.append(data);
   } else if (qcpLessThanSortKey<DataType>(data, *constBegin()))  // quickly handle prepends using preallocated space
   {
@@ -2716,6 +2831,7 @@ void QCPDataContainer<DataType>::add(const DataType &data)
     QCPDataContainer<DataType>::iterator insertionPoint = std::lower_bound(begin(), end(), data, qcpLessThanSortKey<DataType>);
     mData.insert(insertionPoint, data);
   }
+  enforceCapacity();
 }
 
 /*!
@@ -2800,7 +2916,10 @@ void QCPDataContainer<DataType>::remove(double sortKey)
 template <class DataType>
 void QCPDataContainer<DataType>::clear()
 {
-  mData.clear();
+  if (mCapacity > 0)
+    mData.resize(0); // keep the storage of bounded mode
+  else
+    mData.clear();
   mPreallocIteration = 0;
   mPreallocSize = 0;
 }
@@ -3063,6 +3182,15 @@ QCPRange QCPDataContainer<DataType>::valueRange(bool &foundRange, QCP::SignDomai
   }
   if (signDomain == QCP::sdBoth) // range may be anywhere
   {
+    if (!restrictKeyRange || DataType::sortKeyIsMainKey())
+    {
+      // with sorted main keys, the points inside inKeyRange are exactly the non-expanded find range
+      QCPDataContainer<DataType>::const_iterator first = restrictKeyRange ? findBegin(inKeyRange.lower, false) : itBegin;
+      QCPDataContainer<DataType>::const_iterator last = restrictKeyRange ? findEnd(inKeyRange.upper, false) : itEnd;
+      const DataType *firstPoint = first != last ? &*first : 0;
+      if (qcpFindValueRange(firstPoint, firstPoint+(last-first), range, foundRange))
+        return range;
+    }
     for (QCPDataContainer<DataType>::const_iterator it = itBegin; it != itEnd; ++it)
     {
       if (restrictKeyRange && (it->mainKey() < inKeyRange.lower || it->mainKey() > inKeyRange.upper))
@@ -3179,6 +3307,8 @@ void QCPDataContainer<DataType>::preallocateGrow(int minimumPreallocSize)
 template <class DataType>
 void QCPDataContainer<DataType>::performAutoSqueeze()
 {
+  if (mCapacity > 0) // bounded mode keeps its storage
+    return;
   const int totalAlloc = mData.capacity();
   const int postAllocSize = totalAlloc-mData.size();
   const int usedSize = size();
@@ -3197,6 +3327,31 @@ void QCPDataContainer<DataType>::performAutoSqueeze()
   if (shrinkPreAllocation || shrinkPostAllocation)
     squeeze(shrinkPreAllocation, shrinkPostAllocation);
 }
+
+/*! \internal
+
+  In bounded mode (see \ref setCapacity), makes sure \a n data points can be appended without
+  reallocating: if they don't fit behind the current end of the storage, the points are moved back
+  to its start, reusing the space of the expired points in front.
+*/
+template <class DataType>
+void QCPDataContainer<DataType>::prepareBoundedAppend(int n)
+{
+  if (mCapacity > 0 && mPreallocSize > 0 && mData.size()+n > mData.capacity())
+    squeeze(true, false);
+}
+
+/*! \internal
+
+  In bounded mode (see \ref setCapacity), drops the oldest data points exceeding the capacity.
+  Like \ref removeBefore, this only moves the begin of the container.
+*/
+template <class DataType>
+void QCPDataContainer<DataType>::enforceCapacity()
+{
+  if (mCapacity > 0 && size() > mCapacity)
+    mPreallocSize += size()-mCapacity;
+}
 /* end of 'src/datacontainer.cpp' */
 
 
@@ -4390,6 +4545,7 @@ void QCPAbstractPlottable1D<DataType>::drawPolyline(QCPPainter *painter, const Q
 /* end of 'src/plottable1d.h' */
 
 
+#ifndef QCP_NO_COLORMAP
 /* including file 'src/colorgradient.h', size 6243                           */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -4471,6 +4627,7 @@ Q_DECLARE_METATYPE(QCPColorGradient::ColorInterpolation)
 Q_DECLARE_METATYPE(QCPColorGradient::GradientPreset)
 
 /* end of 'src/colorgradient.h' */
+#endif // QCP_NO_COLORMAP
 
 
 /* including file 'src/selectiondecorator-bracket.h', size 4426              */
@@ -4974,6 +5131,7 @@ private:
 /* end of 'src/layoutelements/layoutelement-textelement.h' */
 
 
+#ifndef QCP_NO_COLORMAP
 /* including file 'src/layoutelements/layoutelement-colorscale.h', size 5907 */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -5080,6 +5238,7 @@ private:
 
 
 /* end of 'src/layoutelements/layoutelement-colorscale.h' */
+#endif // QCP_NO_COLORMAP
 
 
 /* including file 'src/plottables/plottable-graph.h', size 8826              */
@@ -5104,6 +5263,10 @@ public:
 };
 Q_DECLARE_TYPEINFO(QCPGraphData, Q_PRIMITIVE_TYPE);
 
+QCP_LIB_DECL bool qcpFindValueRange(const QCPGraphData *begin, const QCPGraphData *end, QCPRange &range, bool &foundRange);
+QCP_LIB_DECL void qcpSetSimdEnabled(bool enabled);
+QCP_LIB_DECL bool qcpSimdEnabled();
+
 
 /*! \typedef QCPGraphDataContainer
   
@@ -5220,6 +5383,7 @@ Q_DECLARE_METATYPE(QCPGraph::LineStyle)
 /* end of 'src/plottables/plottable-graph.h' */
 
 
+#ifndef QCP_NO_CURVE
 /* including file 'src/plottables/plottable-curve.h', size 7409              */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -5333,8 +5497,10 @@ protected:
 Q_DECLARE_METATYPE(QCPCurve::LineStyle)
 
 /* end of 'src/plottables/plottable-curve.h' */
+#endif // QCP_NO_CURVE
 
 
+#ifndef QCP_NO_BARS
 /* including file 'src/plottables/plottable-bars.h', size 8924               */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -5521,8 +5687,10 @@ protected:
 Q_DECLARE_METATYPE(QCPBars::WidthType)
 
 /* end of 'src/plottables/plottable-bars.h' */
+#endif // QCP_NO_BARS
 
 
+#ifndef QCP_NO_STATISTICALBOX
 /* including file 'src/plottables/plottable-statisticalbox.h', size 7516     */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -5638,8 +5806,10 @@ protected:
 };
 
 /* end of 'src/plottables/plottable-statisticalbox.h' */
+#endif // QCP_NO_STATISTICALBOX
 
 
+#ifndef QCP_NO_COLORMAP
 /* including file 'src/plottables/plottable-colormap.h', size 7070           */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -5774,8 +5944,10 @@ protected:
 };
 
 /* end of 'src/plottables/plottable-colormap.h' */
+#endif // QCP_NO_COLORMAP
 
 
+#ifndef QCP_NO_FINANCIAL
 /* including file 'src/plottables/plottable-financial.h', size 8622          */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -5913,8 +6085,10 @@ protected:
 Q_DECLARE_METATYPE(QCPFinancial::ChartStyle)
 
 /* end of 'src/plottables/plottable-financial.h' */
+#endif // QCP_NO_FINANCIAL
 
 
+#ifndef QCP_NO_ERRORBARS
 /* including file 'src/plottables/plottable-errorbar.h', size 7567           */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -6038,8 +6212,10 @@ protected:
 };
 
 /* end of 'src/plottables/plottable-errorbar.h' */
+#endif // QCP_NO_ERRORBARS
 
 
+#ifndef QCP_NO_EXTRA_ITEMS
 /* including file 'src/items/item-straightline.h', size 3117                 */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -6081,8 +6257,10 @@ protected:
 };
 
 /* end of 'src/items/item-straightline.h' */
+#endif // QCP_NO_EXTRA_ITEMS
 
 
+#ifndef QCP_NO_EXTRA_ITEMS
 /* including file 'src/items/item-line.h', size 3407                         */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -6131,8 +6309,10 @@ protected:
 };
 
 /* end of 'src/items/item-line.h' */
+#endif // QCP_NO_EXTRA_ITEMS
 
 
+#ifndef QCP_NO_EXTRA_ITEMS
 /* including file 'src/items/item-curve.h', size 3379                        */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -6182,8 +6362,10 @@ protected:
 };
 
 /* end of 'src/items/item-curve.h' */
+#endif // QCP_NO_EXTRA_ITEMS
 
 
+#ifndef QCP_NO_EXTRA_ITEMS
 /* including file 'src/items/item-rect.h', size 3688                         */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -6241,6 +6423,7 @@ protected:
 };
 
 /* end of 'src/items/item-rect.h' */
+#endif // QCP_NO_EXTRA_ITEMS
 
 
 /* including file 'src/items/item-text.h', size 5554                         */
@@ -6340,6 +6523,7 @@ protected:
 /* end of 'src/items/item-text.h' */
 
 
+#ifndef QCP_NO_EXTRA_ITEMS
 /* including file 'src/items/item-ellipse.h', size 3868                      */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -6400,8 +6584,10 @@ protected:
 };
 
 /* end of 'src/items/item-ellipse.h' */
+#endif // QCP_NO_EXTRA_ITEMS
 
 
+#ifndef QCP_NO_EXTRA_ITEMS
 /* including file 'src/items/item-pixmap.h', size 4373                       */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -6469,8 +6655,10 @@ protected:
 };
 
 /* end of 'src/items/item-pixmap.h' */
+#endif // QCP_NO_EXTRA_ITEMS
 
 
+#ifndef QCP_NO_EXTRA_ITEMS
 /* including file 'src/items/item-tracer.h', size 4762                       */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -6555,8 +6743,10 @@ protected:
 Q_DECLARE_METATYPE(QCPItemTracer::TracerStyle)
 
 /* end of 'src/items/item-tracer.h' */
+#endif // QCP_NO_EXTRA_ITEMS
 
 
+#ifndef QCP_NO_EXTRA_ITEMS
 /* including file 'src/items/item-bracket.h', size 3969                      */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -6622,6 +6812,7 @@ protected:
 Q_DECLARE_METATYPE(QCPItemBracket::BracketStyle)
 
 /* end of 'src/items/item-bracket.h' */
+#endif // QCP_NO_EXTRA_ITEMS
 
 
 #endif // QCUSTOMPLOT_H
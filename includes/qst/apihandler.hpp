@@ -31,6 +31,7 @@
 #include <vector>
 #include <limits>
 #include <tuple>
+#include "rateestimator.hpp"
 #include "utilities.hpp"
 
 #define kInternalChangedFilesCache 5
@@ -57,21 +58,18 @@ namespace api
     APIHandlerBase() = default;
     virtual ~APIHandlerBase() = default;
 
-    virtual ConnectionHealthData getConnections(QByteArray reply) = 0;
+    virtual ConnectionHealthData getConnections(const QJsonObject& replyData) = 0;
 
     APIHandlerBase *getAPIForVersion(int version);
 
     // Consistent across V11/V12
 
-    auto getCurrentFolderList(QByteArray reply) -> std::list<FolderNameFullPath>
+    auto getCurrentFolderList(const QJsonObject& replyData) -> std::list<FolderNameFullPath>
     {
       std::list<FolderNameFullPath> result;
 
-      if (reply.size() > 0)
+      if (!replyData.isEmpty())
       {
-        QString m_DownloadedData = static_cast<QString>(reply);
-        QJsonDocument replyDoc = QJsonDocument::fromJson(m_DownloadedData.toUtf8());
-        QJsonObject replyData = replyDoc.object();
         QJsonArray foldersArray = replyData["folders"].toArray();
         QJsonArray::iterator it;
         foreach (const QJsonValue & value, foldersArray)
@@ -86,43 +84,55 @@ namespace api
       return result;
     }
 
-    // return current traffic in byte/s
-    auto getCurrentTraffic(QByteArray reply) -> TrafficData
+    // return current traffic in kbyte/s, rates are measured on steady_clock,
+    // the wall clock time point only places the sample on the plots
+    auto getCurrentTraffic(const QJsonObject& replyData) -> TrafficData
     {
       using namespace std::chrono;
-      auto now = system_clock::now();
-      auto timeDelta = duration_cast<milliseconds>(now - std::get<2>(oldTraffic));
+      const auto now = system_clock::now();
       double curInBytes, curOutBytes;
-      if (reply.size() == 0)
+      if (replyData.isEmpty())
       {
         curInBytes = curOutBytes = (std::numeric_limits<double>::min)();
       }
       else
       {
-        QString m_DownloadedData = static_cast<QString>(reply);
-        QJsonDocument replyDoc = QJsonDocument::fromJson(m_DownloadedData.toUtf8());
-        QJsonObject replyData = replyDoc.object();
+        const auto steadyNow = steady_clock::now();
         QJsonObject connectionArray = replyData["total"].toObject();
-        double inBytes = static_cast<double>(connectionArray.find("inBytesTotal").value().toDouble());
-        double outBytes = static_cast<double>(connectionArray.find("outBytesTotal").value().toDouble());
-        curInBytes = (std::max)(0.0, ((inBytes - std::get<0>(oldTraffic)) / (timeDelta.count() * 1e-3)))
+        // QJsonValue stores numbers as double, which is exact up to 2^53 bytes
+        const auto inBytes = static_cast<std::uint64_t>((std::max)(0.0,
+          connectionArray.find("inBytesTotal").value().toDouble()));
+        const auto outBytes = static_cast<std::uint64_t>((std::max)(0.0,
+          connectionArray.find("outBytesTotal").value().toDouble()));
+        inTraffic.addSample(inBytes, steadyNow);
+        outTraffic.addSample(outBytes, steadyNow);
+        curInBytes = std::floor(inTraffic.statistics(steadyNow).current * 100) / 100
           + (std::numeric_limits<double>::min)();
-        curOutBytes = (std::max)(0.0, ((outBytes - std::get<1>(oldTraffic)) / (timeDelta.count()* 1e-3)))
+        curOutBytes = std::floor(outTraffic.statistics(steadyNow).current * 100) / 100
           + (std::numeric_limits<double>::min)();
-        curInBytes = std::floor(curInBytes * 100) / 100;
-        curOutBytes = std::floor(curOutBytes * 100) / 100;
-        oldTraffic = std::make_tuple(inBytes, outBytes, now);
       }
-      return std::make_tuple(std::move(curInBytes/kBytesToKilobytes),
-        std::move(curOutBytes/kBytesToKilobytes), std::move(now));
+      return std::make_tuple(curInBytes/kBytesToKilobytes,
+        curOutBytes/kBytesToKilobytes, now);
     }
 
-    auto getLastSyncedFiles(QByteArray reply) -> LastSyncedFileList
+    // smoothed and windowed traffic in kbyte/s
+    auto getTrafficStatistics() const -> stats::TrafficStatistics
     {
-      QString m_DownloadedData = static_cast<QString>(reply);
-      QJsonDocument replyDoc = QJsonDocument::fromJson(m_DownloadedData.toUtf8());
-      QJsonObject replyData = replyDoc.object();
+      const auto toKilobytes = [](stats::RateStatistics rates)
+      {
+        for (double* value : {&rates.current, &rates.smoothed, &rates.min,
+          &rates.avg, &rates.max})
+        {
+          *value /= kBytesToKilobytes;
+        }
+        return rates;
+      };
+      return {toKilobytes(inTraffic.statistics()),
+        toKilobytes(outTraffic.statistics())};
+    }
 
+    auto getLastSyncedFiles(const QJsonObject& replyData) -> LastSyncedFileList
+    {
       QStringList folderNames = replyData.keys();
       for (QString folderName : folderNames)
       {
@@ -164,7 +174,8 @@ namespace api
       return fileList;
     }
 
-    std::tuple<float, float, std::chrono::time_point<std::chrono::system_clock>> oldTraffic;
+    stats::RateEstimator inTraffic;
+    stats::RateEstimator outTraffic;
     LastSyncedFileList fileList;
   };
 
@@ -179,11 +190,11 @@ namespace api
   {
     const int version = 11;
 
-    auto getConnections(QByteArray reply) -> ConnectionHealthData override
+    auto getConnections(const QJsonObject& replyData) -> ConnectionHealthData override
     {
       ConnectionHealthData result;
       result.emplace("state", "0");
-      if (reply.size() == 0)
+      if (replyData.isEmpty())
       {
         result.emplace("activeConnections", 0);
         result.emplace("totalConnections", 0);
@@ -192,9 +203,6 @@ namespace api
       {
         result.clear();
         result.emplace("state", 1);
-        QString m_DownloadedData = static_cast<QString>(reply);
-        QJsonDocument replyDoc = QJsonDocument::fromJson(m_DownloadedData.toUtf8());
-        QJsonObject replyData = replyDoc.object();
         QJsonObject connectionArray = replyData["connections"].toObject();
         result.emplace("activeConnections", connectionArray.size());
         result.emplace("totalConnections", connectionArray.size());
@@ -209,11 +217,11 @@ namespace api
   {
     const int version = 12;
 
-    auto getConnections(QByteArray reply) -> ConnectionHealthData override
+    auto getConnections(const QJsonObject& replyData) -> ConnectionHealthData override
     {
       ConnectionHealthData result;
       result.emplace("state", "0");
-      if (reply.size() == 0)
+      if (replyData.isEmpty())
       {
         result.emplace("activeConnections", 0);
         result.emplace("totalConnections", 0);
@@ -222,9 +230,6 @@ namespace api
       {
         result.clear();
         result.emplace("state", 1);
-        QString m_DownloadedData = static_cast<QString>(reply);
-        QJsonDocument replyDoc = QJsonDocument::fromJson(m_DownloadedData.toUtf8());
-        QJsonObject replyData = replyDoc.object();
         QJsonObject connectionArray = replyData["connections"].toObject();
         int active = 0;
         for (QJsonObject::Iterator it = connectionArray.begin();
@@ -271,7 +276,8 @@ namespace api
     }
 
 
-    auto getConnectionVersionInfo(NetReply *reply) -> std::pair<QString, bool>
+    auto getConnectionVersionInfo(NetReply *reply, const QJsonObject& replyData)
+      -> std::pair<QString, bool>
     {
       QString result;
       bool success = false;
@@ -282,9 +288,6 @@ namespace api
       }
       else
       {
-        QString m_DownloadedData = static_cast<QString>(reply->readAll());
-        QJsonDocument replyDoc = QJsonDocument::fromJson(m_DownloadedData.toUtf8());
-        QJsonObject replyData = replyDoc.object();
         result = replyData.value("version").toString();
         success = true;
       }
@@ -0,0 +1,99 @@
+/******************************************************************************
+ // QSyncthingTray
+ // Copyright (c) Matthias Frick, All rights reserved.
+ //
+ // This library is free software; you can redistribute it and/or
+ // modify it under the terms of the GNU Lesser General Public
+ // License as published by the Free Software Foundation; either
+ // version 3.0 of the License, or (at your option) any later version.
+ //
+ // This library is distributed in the hope that it will be useful,
+ // but WITHOUT ANY WARRANTY; without even the implied warranty of
+ // MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ // Lesser General Public License for more details.
+ //
+ // You should have received a copy of the GNU Lesser General Public
+ // License along with this library.
+ ******************************************************************************/
+
+#ifndef HISTORYLOG_H
+#define HISTORYLOG_H
+
+#pragma once
+#include <QFile>
+#include <QString>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace qst
+{
+namespace stats
+{
+
+//------------------------------------------------------------------------------------//
+
+enum class HistorySeries : std::uint32_t
+{
+  traffic = 0,
+  connections = 1
+};
+
+// fixed size on-disk record, naturally aligned to 24 bytes
+struct HistoryRecord
+{
+  double time;
+  float values[2];
+  HistorySeries series;
+  std::uint32_t reserved;
+};
+
+
+//------------------------------------------------------------------------------------//
+// Append-only log of stats samples under the app data directory.
+// Records are collected in memory and written out in batches, the log is
+// rotated once it grows past kMaxFileBytes so at most two files are kept.
+// A file holds what the coarsest history tier retains at 1 Hz polling, so
+// the two files always cover the browsable history.
+// Reading maps the files into memory and walks the records in place.
+//------------------------------------------------------------------------------------//
+
+class HistoryLog
+{
+public:
+  using RecordCallback = std::function<void(const HistoryRecord&)>;
+
+  explicit HistoryLog(const QString& directory = defaultDirectory());
+  ~HistoryLog();
+  HistoryLog(const HistoryLog&) = delete;
+  HistoryLog& operator=(const HistoryLog&) = delete;
+
+  // replays rotated and current file, oldest record first; records past
+  // the retention, of unknown series or going back in time are skipped
+  void load(const RecordCallback& callback);
+  void append(const HistoryRecord& record);
+  void flush();
+
+  static QString defaultDirectory();
+
+private:
+  bool readFile(const QString& path, const RecordCallback& callback);
+  bool openForAppend();
+  void rotate();
+
+  static const std::size_t kMaxFileBytes;
+  static const std::size_t kMaxPendingRecords;
+  static const std::chrono::seconds kFlushInterval;
+
+  QString mFilePath;
+  QString mRotatedFilePath;
+  QFile mFile;
+  std::vector<HistoryRecord> mPending;
+  std::chrono::steady_clock::time_point mLastFlush;
+};
+
+} // stats namespace
+} // qst namespace
+
+#endif
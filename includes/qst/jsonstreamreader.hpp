@@ -0,0 +1,242 @@
+/******************************************************************************
+ // QSyncthingTray
+ // Copyright (c) Matthias Frick, All rights reserved.
+ //
+ // This library is free software; you can redistribute it and/or
+ // modify it under the terms of the GNU Lesser General Public
+ // License as published by the Free Software Foundation; either
+ // version 3.0 of the License, or (at your option) any later version.
+ //
+ // This library is distributed in the hope that it will be useful,
+ // but WITHOUT ANY WARRANTY; without even the implied warranty of
+ // MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ // Lesser General Public License for more details.
+ //
+ // You should have received a copy of the GNU Lesser General Public
+ // License along with this library.
+ ******************************************************************************/
+
+#ifndef jsonstreamreader_h
+#define jsonstreamreader_h
+#pragma once
+
+#include <QByteArray>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <algorithm>
+#include <cctype>
+#include <functional>
+
+namespace qst
+{
+namespace api
+{
+
+//------------------------------------------------------------------------------------//
+// Incremental JSON reader fed from QNetworkReply::readyRead.
+// The root object/array is split into its top-level members while bytes
+// arrive, every completed member is parsed right away and dropped from the
+// buffer. Only the member currently in flight is ever held as raw bytes.
+// Nesting is not split further: a single large member, like the "folders"
+// array of /rest/system/config, is still buffered and parsed as a whole,
+// and the result is built up as one document. This pays off for replies
+// made of many small members, like the array of /rest/events.
+//------------------------------------------------------------------------------------//
+
+class JsonStreamReader
+{
+public:
+  using ElementCallback = std::function<void(const QJsonValue&)>;
+
+  JsonStreamReader() = default;
+
+  // optional hook invoked for every top-level array element as it completes
+  void setElementCallback(ElementCallback callback)
+  {
+    mElementCallback = callback;
+  }
+
+  void reserve(const qint64 expectedSize)
+  {
+    // never reserve more than a few members worth of bytes
+    const qint64 maxReserve = 64 * 1024;
+    mBuffer.reserve(static_cast<int>((std::min)(expectedSize, maxReserve)));
+  }
+
+  void feed(const QByteArray& chunk)
+  {
+    if (mFinished || mError || chunk.isEmpty())
+    {
+      return;
+    }
+    mBuffer.append(chunk);
+    scan();
+  }
+
+  bool isFinished() const
+  {
+    return mFinished;
+  }
+
+  bool hasError() const
+  {
+    return mError || (!mFinished && mRoot != kNone);
+  }
+
+  int bufferedBytes() const
+  {
+    return mBuffer.size();
+  }
+
+  auto object() const -> QJsonObject
+  {
+    return mError ? QJsonObject() : mObject;
+  }
+
+  auto array() const -> QJsonArray
+  {
+    return mError ? QJsonArray() : mArray;
+  }
+
+private:
+  enum RootType { kNone, kObject, kArray };
+
+  void scan()
+  {
+    const char* data = mBuffer.constData();
+    const int size = mBuffer.size();
+    int pos = mScanPos;
+    for (; pos < size && !mFinished && !mError; ++pos)
+    {
+      const char c = data[pos];
+      if (mRoot == kNone)
+      {
+        if (std::isspace(static_cast<unsigned char>(c)))
+        {
+          continue;
+        }
+        if (c != '{' && c != '[')
+        {
+          mError = true;
+          break;
+        }
+        mRoot = c == '{' ? kObject : kArray;
+        mDepth = 1;
+        mMemberStart = pos + 1;
+        continue;
+      }
+      if (mInString)
+      {
+        if (mEscaped)
+        {
+          mEscaped = false;
+        }
+        else if (c == '\\')
+        {
+          mEscaped = true;
+        }
+        else if (c == '"')
+        {
+          mInString = false;
+        }
+        continue;
+      }
+      switch (c)
+      {
+        case '"':
+          mInString = true;
+          break;
+        case '{':
+        case '[':
+          ++mDepth;
+          break;
+        case '}':
+        case ']':
+          if (--mDepth == 0)
+          {
+            flushMember(mMemberStart, pos);
+            mFinished = true;
+          }
+          break;
+        case ',':
+          if (mDepth == 1)
+          {
+            flushMember(mMemberStart, pos);
+            mMemberStart = pos + 1;
+          }
+          break;
+        default:
+          break;
+      }
+    }
+
+    // drop everything that has already been parsed
+    const int consumed = mFinished ? size : mMemberStart;
+    if (consumed > 0)
+    {
+      mBuffer.remove(0, consumed);
+      mMemberStart -= consumed;
+      pos -= consumed;
+    }
+    mScanPos = pos;
+    if (mFinished)
+    {
+      mBuffer.clear();
+      mBuffer.squeeze();
+    }
+  }
+
+  void flushMember(const int begin, const int end)
+  {
+    const QByteArray member = mBuffer.mid(begin, end - begin).trimmed();
+    if (member.isEmpty())
+    {
+      return;
+    }
+    QJsonParseError parseError;
+    const auto doc = mRoot == kObject ?
+      QJsonDocument::fromJson("{" + member + "}", &parseError) :
+      QJsonDocument::fromJson("[" + member + "]", &parseError);
+    if (parseError.error != QJsonParseError::NoError)
+    {
+      mError = true;
+      return;
+    }
+    if (mRoot == kObject)
+    {
+      const QJsonObject entry = doc.object();
+      for (auto it = entry.constBegin(); it != entry.constEnd(); ++it)
+      {
+        mObject.insert(it.key(), it.value());
+      }
+    }
+    else if (mElementCallback)
+    {
+      mElementCallback(doc.array().first());
+    }
+    else
+    {
+      mArray.append(doc.array().first());
+    }
+  }
+
+  QByteArray mBuffer;
+  QJsonObject mObject;
+  QJsonArray mArray;
+  ElementCallback mElementCallback;
+  RootType mRoot = kNone;
+  int mDepth = 0;
+  int mScanPos = 0;
+  int mMemberStart = 0;
+  bool mInString = false;
+  bool mEscaped = false;
+  bool mFinished = false;
+  bool mError = false;
+};
+
+} // api
+} // qst
+
+#endif /* jsonstreamreader_h */
@@ -0,0 +1,231 @@
+/******************************************************************************
+ // QSyncthingTray
+ // Copyright (c) Matthias Frick, All rights reserved.
+ //
+ // This library is free software; you can redistribute it and/or
+ // modify it under the terms of the GNU Lesser General Public
+ // License as published by the Free Software Foundation; either
+ // version 3.0 of the License, or (at your option) any later version.
+ //
+ // This library is distributed in the hope that it will be useful,
+ // but WITHOUT ANY WARRANTY; without even the implied warranty of
+ // MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ // Lesser General Public License for more details.
+ //
+ // You should have received a copy of the GNU Lesser General Public
+ // License along with this library.
+ ******************************************************************************/
+
+#ifndef keyedmenu_h
+#define keyedmenu_h
+#pragma once
+
+#include <QAction>
+#include <QHash>
+#include <QList>
+#include <QMenu>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <cstdint>
+#include <functional>
+
+namespace qst
+{
+namespace menu
+{
+
+//------------------------------------------------------------------------------------//
+// Keeps the actions of a menu in line with a list of items, one action per
+// key. An update only inserts, removes or moves the actions whose items
+// came or went and marks the ones whose item changed; actions of items that
+// stayed the same are left alone. Text and state of an action are set by
+// the apply function, and only for marked actions right before the menu is
+// shown, so a list that changes every poll costs nothing while the menu is
+// closed. The key of each action is kept as its data, for the click handler.
+//------------------------------------------------------------------------------------//
+
+template<typename Item>
+class KeyedMenu
+{
+public:
+  using KeyFunction = std::function<QString(const Item&)>;
+  using ApplyFunction = std::function<void(QAction*, const Item&)>;
+
+  // what an update did to the menu
+  struct Changes
+  {
+    int inserted = 0;
+    int updated = 0;
+    int removed = 0;
+    int moved = 0;
+  };
+
+  // the placeholder is shown, disabled, while there are no items
+  KeyedMenu(QMenu* menu, KeyFunction key, ApplyFunction apply,
+    const QString& placeholder = QString()) :
+      mpMenu(menu)
+    , mKey(key)
+    , mApply(apply)
+  {
+    if (!placeholder.isEmpty())
+    {
+      mpPlaceholder = mpMenu->addAction(placeholder);
+      mpPlaceholder->setDisabled(true);
+    }
+    mAboutToShow = QObject::connect(mpMenu, &QMenu::aboutToShow, mpMenu, [this]
+    {
+      applyPending();
+    });
+  }
+
+  ~KeyedMenu()
+  {
+    QObject::disconnect(mAboutToShow);
+  }
+
+  KeyedMenu(const KeyedMenu&) = delete;
+  KeyedMenu& operator=(const KeyedMenu&) = delete;
+
+  template<typename Container>
+  Changes update(const Container& items)
+  {
+    Changes changes;
+    ++mGeneration;
+    QList<QAction*> order;
+    order.reserve(static_cast<int>(items.size()));
+    for (const auto& item : items)
+    {
+      const auto key = mKey(item);
+      auto entry = mEntries.find(key);
+      if (entry == mEntries.end())
+      {
+        Entry added;
+        added.action = new QAction(mpMenu);
+        added.action->setData(key);
+        added.item = item;
+        entry = mEntries.insert(key, added);
+        markPending(entry, key);
+        ++changes.inserted;
+      }
+      else if (entry->generation == mGeneration)
+      {
+        // a duplicate key, the first item wins
+        continue;
+      }
+      else if (!(entry->item == item))
+      {
+        entry->item = item;
+        markPending(entry, key);
+        ++changes.updated;
+      }
+      entry->generation = mGeneration;
+      order.push_back(entry->action);
+    }
+
+    for (auto entry = mEntries.begin(); entry != mEntries.end();)
+    {
+      if (entry->generation != mGeneration)
+      {
+        mpMenu->removeAction(entry->action);
+        mOrder.removeOne(entry->action);
+        entry->action->deleteLater();
+        entry = mEntries.erase(entry);
+        ++changes.removed;
+      }
+      else
+      {
+        ++entry;
+      }
+    }
+
+    if (mOrder.isEmpty())
+    {
+      mpMenu->addActions(order);
+    }
+    else
+    {
+      // only actions out of place are moved, a list that keeps its order
+      // is a single pass
+      for (int idx = 0; idx < order.size(); ++idx)
+      {
+        if (idx < mOrder.size() && mOrder[idx] == order[idx])
+        {
+          continue;
+        }
+        const auto action = order[idx];
+        if (mOrder.removeOne(action))
+        {
+          ++changes.moved;
+        }
+        mpMenu->insertAction(idx < mOrder.size() ? mOrder[idx] : nullptr, action);
+        mOrder.insert(idx, action);
+      }
+    }
+    mOrder = order;
+    if (mpPlaceholder != nullptr)
+    {
+      mpPlaceholder->setVisible(order.isEmpty());
+    }
+    if (mpMenu->isVisible())
+    {
+      applyPending();
+    }
+    return changes;
+  }
+
+  // sets text and state of the actions whose item changed, done by the
+  // menu itself before it is shown
+  void applyPending()
+  {
+    for (const auto& key : mPendingKeys)
+    {
+      auto entry = mEntries.find(key);
+      if (entry != mEntries.end() && entry->pending)
+      {
+        mApply(entry->action, entry->item);
+        entry->pending = false;
+      }
+    }
+    mPendingKeys.clear();
+  }
+
+  int size() const
+  {
+    return mOrder.size();
+  }
+
+private:
+  struct Entry
+  {
+    QAction* action = nullptr;
+    Item item;
+    std::uint64_t generation = 0;
+    bool pending = false;
+  };
+
+  void markPending(typename QHash<QString, Entry>::iterator entry, const QString& key)
+  {
+    if (!entry->pending)
+    {
+      entry->pending = true;
+      mPendingKeys.push_back(key);
+    }
+  }
+
+  QMenu* mpMenu;
+  KeyFunction mKey;
+  ApplyFunction mApply;
+  QAction* mpPlaceholder = nullptr;
+  QMetaObject::Connection mAboutToShow;
+  QHash<QString, Entry> mEntries;
+  // our actions in menu order
+  QList<QAction*> mOrder;
+  QStringList mPendingKeys;
+  std::uint64_t mGeneration = 0;
+};
+
+} // menu
+} // qst
+
+#endif /* keyedmenu_h */
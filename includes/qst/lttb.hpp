@@ -0,0 +1,165 @@
+/******************************************************************************
+ // QSyncthingTray
+ // Copyright (c) Matthias Frick, All rights reserved.
+ //
+ // This library is free software; you can redistribute it and/or
+ // modify it under the terms of the GNU Lesser General Public
+ // License as published by the Free Software Foundation; either
+ // version 3.0 of the License, or (at your option) any later version.
+ //
+ // This library is distributed in the hope that it will be useful,
+ // but WITHOUT ANY WARRANTY; without even the implied warranty of
+ // MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ // Lesser General Public License for more details.
+ //
+ // You should have received a copy of the GNU Lesser General Public
+ // License along with this library.
+ ******************************************************************************/
+
+#ifndef lttb_h
+#define lttb_h
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace qst
+{
+namespace stats
+{
+
+//------------------------------------------------------------------------------------//
+// Streaming Largest-Triangle-Three-Buckets downsampling.
+// Time is cut into buckets of a fixed width, aligned to multiples of it, and
+// every bucket is reduced to the one sample that spans the largest triangle
+// with the sample kept for the previous bucket and the mean of the next
+// bucket. Unlike averaging, this keeps spikes. Since buckets are aligned, the
+// choice for a bucket is final as soon as the bucket after it is complete, so
+// samples can be pushed one at a time and the output only ever grows.
+// The last two buckets are still undecided; pending() returns their samples.
+//------------------------------------------------------------------------------------//
+
+class LttbDecimator
+{
+public:
+  // a width of 0 passes every sample through
+  explicit LttbDecimator(const double bucketWidth = 0)
+  {
+    reset(bucketWidth);
+  }
+
+  void reset(const double bucketWidth)
+  {
+    mBucketWidth = bucketWidth;
+    mHasAnchor = false;
+    mBucket.clear();
+    mNext.clear();
+  }
+
+  double bucketWidth() const
+  {
+    return mBucketWidth;
+  }
+
+  // samples have to be pushed in time order, settled ones go to out
+  template<typename TimeOut, typename ValueOut>
+  std::size_t push(const double time, const double value, TimeOut& timeOut,
+    ValueOut& valueOut)
+  {
+    const Point point{time, value};
+    if (mBucketWidth <= 0 || !mHasAnchor)
+    {
+      // the first sample is always kept
+      mAnchor = point;
+      mHasAnchor = true;
+      timeOut.push_back(time);
+      valueOut.push_back(value);
+      return 1;
+    }
+    const auto index = static_cast<std::int64_t>(std::floor(time / mBucketWidth));
+    if (mBucket.empty() || index == mBucketIndex)
+    {
+      mBucketIndex = index;
+      mBucket.push_back(point);
+      return 0;
+    }
+    if (mNext.empty() || index == mNextIndex)
+    {
+      mNextIndex = index;
+      mNext.push_back(point);
+      return 0;
+    }
+    mAnchor = select();
+    timeOut.push_back(mAnchor.time);
+    valueOut.push_back(mAnchor.value);
+    mBucket.swap(mNext);
+    mBucketIndex = mNextIndex;
+    mNext.clear();
+    mNext.push_back(point);
+    mNextIndex = index;
+    return 1;
+  }
+
+  template<typename TimeOut, typename ValueOut>
+  void pending(TimeOut& timeOut, ValueOut& valueOut) const
+  {
+    for (const auto& bucket : {&mBucket, &mNext})
+    {
+      for (const auto& point : *bucket)
+      {
+        timeOut.push_back(point.time);
+        valueOut.push_back(point.value);
+      }
+    }
+  }
+
+private:
+  struct Point
+  {
+    double time;
+    double value;
+  };
+
+  Point select() const
+  {
+    Point next{0, 0};
+    for (const auto& point : mNext)
+    {
+      next.time += point.time;
+      next.value += point.value;
+    }
+    next.time /= mNext.size();
+    next.value /= mNext.size();
+
+    // twice the triangle area, the factor does not change the choice
+    const auto dt = mAnchor.time - next.time;
+    const auto dv = next.value - mAnchor.value;
+    Point best = mBucket.front();
+    double bestArea = -1;
+    for (const auto& point : mBucket)
+    {
+      const auto area = std::abs(dt * (point.value - mAnchor.value) -
+        (mAnchor.time - point.time) * dv);
+      if (area > bestArea)
+      {
+        bestArea = area;
+        best = point;
+      }
+    }
+    return best;
+  }
+
+  double mBucketWidth = 0;
+  bool mHasAnchor = false;
+  Point mAnchor{0, 0};
+  std::vector<Point> mBucket;
+  std::vector<Point> mNext;
+  std::int64_t mBucketIndex = 0;
+  std::int64_t mNextIndex = 0;
+};
+
+} // stats
+} // qst
+
+#endif /* lttb_h */
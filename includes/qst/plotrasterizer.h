@@ -0,0 +1,154 @@
+/******************************************************************************
+ // QSyncthingTray
+ // Copyright (c) Matthias Frick, All rights reserved.
+ //
+ // This library is free software; you can redistribute it and/or
+ // modify it under the terms of the GNU Lesser General Public
+ // License as published by the Free Software Foundation; either
+ // version 3.0 of the License, or (at your option) any later version.
+ //
+ // This library is distributed in the hope that it will be useful,
+ // but WITHOUT ANY WARRANTY; without even the implied warranty of
+ // MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ // Lesser General Public License for more details.
+ //
+ // You should have received a copy of the GNU Lesser General Public
+ // License along with this library.
+ ******************************************************************************/
+
+
+#ifndef PLOTRASTERIZER_H
+#define PLOTRASTERIZER_H
+
+#pragma once
+#include <QImage>
+#include <QMetaType>
+#include <QObject>
+#include <QPen>
+#include <QSize>
+#include <QVector>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <contrib/qcustomplot.h>
+
+namespace qst
+{
+namespace stats
+{
+
+//------------------------------------------------------------------------------------//
+
+// everything needed to draw the graphs of a plot, copied on the GUI thread
+// so the worker never touches the QCustomPlot
+struct PlotFrameRequest
+{
+  struct Graph
+  {
+    QPen pen;
+    QVector<double> keys;
+    QVector<double> values;
+  };
+
+  QSize size;
+  double devicePixelRatio = 1;
+  QCPRange keyRange;
+  QCPRange valueRange;
+  // the graphs changed from this key on, before it they are as last requested
+  double changedFrom = -std::numeric_limits<double>::infinity();
+  std::vector<Graph> graphs;
+};
+
+struct PlotFrame
+{
+  QImage image;
+  QCPRange keyRange;
+  QCPRange valueRange;
+};
+
+// copies the graphs of the plot and its current ranges
+PlotFrameRequest snapshotGraphs(QCustomPlot* plot, const double changedFrom);
+
+
+//------------------------------------------------------------------------------------//
+// Draws the graphs of one plot into an image on a worker thread, so long
+// histories never block the GUI thread. Only the newest request is drawn:
+// a waiting request is replaced by a newer one, and a frame finished while
+// a newer request is waiting is thrown away. The frame is kept between
+// requests; if the key range only moved on by whole pixels, it is scrolled
+// and just the new strip is drawn.
+//------------------------------------------------------------------------------------//
+
+class PlotRasterizer : public QObject
+{
+  Q_OBJECT
+public:
+  explicit PlotRasterizer(QObject* parent = nullptr);
+  ~PlotRasterizer();
+  PlotRasterizer(const PlotRasterizer&) = delete;
+  PlotRasterizer& operator=(const PlotRasterizer&) = delete;
+
+  void submit(PlotFrameRequest request);
+
+  std::uint64_t renderedFrames() const;
+  std::uint64_t scrolledFrames() const;
+  // requests replaced before they were drawn and frames replaced before
+  // they were shown
+  std::uint64_t droppedFrames() const;
+
+signals:
+  void frameReady(const qst::stats::PlotFrame& frame);
+
+private:
+  void run();
+  bool render(const PlotFrameRequest& request);
+
+  // worker thread only
+  std::unique_ptr<QCPPaintBufferImage> mpBuffer;
+  QCPRange mKeyRange;
+  QCPRange mValueRange;
+
+  std::mutex mMutex;
+  std::condition_variable mWakeUp;
+  PlotFrameRequest mPending;
+  bool mHasPending = false;
+  bool mStop = false;
+  std::atomic<std::uint64_t> mRendered{0};
+  std::atomic<std::uint64_t> mScrolled{0};
+  std::atomic<std::uint64_t> mDropped{0};
+  std::thread mThread;
+};
+
+
+//------------------------------------------------------------------------------------//
+// Shows the last frame of a PlotRasterizer in place of the graphs.
+//------------------------------------------------------------------------------------//
+
+class PlotFrameLayerable : public QCPLayerable
+{
+public:
+  PlotFrameLayerable(QCPAxisRect* axisRect, const QString& layer);
+  void setFrame(const PlotFrame& frame);
+  const PlotFrame& frame() const;
+
+protected:
+  void applyDefaultAntialiasingHint(QCPPainter* painter) const override;
+  void draw(QCPPainter* painter) override;
+  QRect clipRect() const override;
+
+private:
+  QCPAxisRect* mpAxisRect;
+  PlotFrame mFrame;
+};
+
+} // stats namespace
+} // qst namespace
+
+Q_DECLARE_METATYPE(qst::stats::PlotFrame)
+
+#endif
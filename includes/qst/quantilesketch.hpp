@@ -0,0 +1,291 @@
+/******************************************************************************
+ // QSyncthingTray
+ // Copyright (c) Matthias Frick, All rights reserved.
+ //
+ // This library is free software; you can redistribute it and/or
+ // modify it under the terms of the GNU Lesser General Public
+ // License as published by the Free Software Foundation; either
+ // version 3.0 of the License, or (at your option) any later version.
+ //
+ // This library is distributed in the hope that it will be useful,
+ // but WITHOUT ANY WARRANTY; without even the implied warranty of
+ // MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ // Lesser General Public License for more details.
+ //
+ // You should have received a copy of the GNU Lesser General Public
+ // License along with this library.
+ ******************************************************************************/
+
+#ifndef quantilesketch_h
+#define quantilesketch_h
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace qst
+{
+namespace stats
+{
+
+//------------------------------------------------------------------------------------//
+// Mergeable streaming quantile sketch with relative error guarantees.
+// Values are counted in logarithmic bins, bin i covering (gamma^(i-1), gamma^i],
+// so every quantile is estimated within kRelativeAccuracy of the true value.
+// The bins are a fixed window of kNumBins keys; once values span more than
+// that, the lowest bins are collapsed into one, which only affects the low
+// quantiles. Memory is fixed and two sketches merge by adding their bins.
+//------------------------------------------------------------------------------------//
+
+class QuantileSketch
+{
+public:
+  static const std::size_t kNumBins = 256;
+
+  QuantileSketch()
+  {
+    clear();
+  }
+
+  void add(const double value, const std::uint64_t count = 1)
+  {
+    mCount += count;
+    if (!(value > kMinValue))
+    {
+      mZeroCount += count;
+      return;
+    }
+    addKey(key(value), count);
+  }
+
+  void merge(const QuantileSketch& other)
+  {
+    mCount += other.mZeroCount;
+    mZeroCount += other.mZeroCount;
+    if (!other.mHasBins)
+    {
+      return;
+    }
+    for (std::size_t bin = 0; bin < kNumBins; ++bin)
+    {
+      if (other.mBins[bin] > 0)
+      {
+        mCount += other.mBins[bin];
+        addKey(other.mOffset + static_cast<int>(bin), other.mBins[bin]);
+      }
+    }
+  }
+
+  // q in [0, 1]
+  double quantile(const double q) const
+  {
+    if (mCount == 0)
+    {
+      return 0;
+    }
+    const auto rank = static_cast<std::uint64_t>(
+      (std::max)(0.0, (std::min)(q, 1.0)) * static_cast<double>(mCount - 1));
+    std::uint64_t seen = mZeroCount;
+    if (rank < seen)
+    {
+      return 0;
+    }
+    for (std::size_t bin = 0; bin < kNumBins; ++bin)
+    {
+      seen += mBins[bin];
+      if (rank < seen)
+      {
+        return value(mOffset + static_cast<int>(bin));
+      }
+    }
+    return value(mOffset + static_cast<int>(kNumBins) - 1);
+  }
+
+  std::uint64_t count() const
+  {
+    return mCount;
+  }
+
+  bool empty() const
+  {
+    return mCount == 0;
+  }
+
+  void clear()
+  {
+    mBins.fill(0);
+    mOffset = 0;
+    mHasBins = false;
+    mZeroCount = 0;
+    mCount = 0;
+  }
+
+private:
+  static constexpr double kRelativeAccuracy = 0.02;
+  static constexpr double kGamma = (1 + kRelativeAccuracy) / (1 - kRelativeAccuracy);
+  // anything below counts as idle
+  static constexpr double kMinValue = 1e-3;
+
+  static int key(const double value)
+  {
+    static const double invLogGamma = 1 / std::log(kGamma);
+    return static_cast<int>(std::ceil(std::log(value) * invLogGamma));
+  }
+
+  // the estimate with the smallest relative error for the bin
+  static double value(const int key)
+  {
+    return 2 * std::pow(kGamma, key) / (kGamma + 1);
+  }
+
+  void addKey(const int key, const std::uint64_t count)
+  {
+    const int numBins = static_cast<int>(kNumBins);
+    if (!mHasBins)
+    {
+      // start in the middle, leaving room in both directions
+      mOffset = key - numBins / 2;
+      mHasBins = true;
+    }
+    else if (key >= mOffset + numBins)
+    {
+      // slide up, everything that falls off the bottom is collapsed
+      const int shift = key - (mOffset + numBins) + 1;
+      std::uint64_t collapsed = 0;
+      for (int bin = 0; bin < (std::min)(shift, numBins); ++bin)
+      {
+        collapsed += mBins[bin];
+      }
+      if (shift < numBins)
+      {
+        std::copy(mBins.begin() + shift, mBins.end(), mBins.begin());
+      }
+      std::fill(mBins.end() - (std::min)(shift, numBins), mBins.end(), 0);
+      mBins[0] += static_cast<std::uint32_t>(collapsed);
+      mOffset += shift;
+    }
+    const int bin = (std::max)(key - mOffset, 0);
+    mBins[bin] += static_cast<std::uint32_t>(count);
+  }
+
+  std::array<std::uint32_t, kNumBins> mBins;
+  int mOffset;
+  bool mHasBins;
+  std::uint64_t mZeroCount;
+  std::uint64_t mCount;
+};
+
+
+//------------------------------------------------------------------------------------//
+// Quantiles over a sliding time window. The window is split into slices
+// with one sketch each; a sample only touches the sketch of its slice and a
+// query merges the slices inside the window. The window edge therefore
+// moves in steps of one slice.
+//------------------------------------------------------------------------------------//
+
+class WindowedQuantiles
+{
+public:
+  WindowedQuantiles(const double window, const std::size_t numSlices) :
+      mSliceLength(window / numSlices)
+    , mSlots(numSlices)
+  {
+  }
+
+  // samples have to be added in time order
+  void add(const double time, const double value)
+  {
+    const auto index = static_cast<std::int64_t>(std::floor(time / mSliceLength));
+    auto& slot = mSlots[static_cast<std::size_t>(index) % mSlots.size()];
+    if (slot.index != index)
+    {
+      slot.sketch.clear();
+      slot.index = index;
+    }
+    slot.sketch.add(value);
+    mLastIndex = index;
+  }
+
+  // merged sketch of the window ending at the newest sample
+  QuantileSketch sketch() const
+  {
+    QuantileSketch result;
+    for (const auto& slot : mSlots)
+    {
+      if (slot.index > mLastIndex - static_cast<std::int64_t>(mSlots.size()))
+      {
+        result.merge(slot.sketch);
+      }
+    }
+    return result;
+  }
+
+private:
+  struct Slot
+  {
+    std::int64_t index = -1;
+    QuantileSketch sketch;
+  };
+
+  double mSliceLength;
+  std::vector<Slot> mSlots;
+  std::int64_t mLastIndex = 0;
+};
+
+
+//------------------------------------------------------------------------------------//
+
+struct Percentiles
+{
+  double p50;
+  double p95;
+  double p99;
+  std::uint64_t count;
+};
+
+enum PercentileWindow { kLastHour, kLastDay, kLastWeek, kNumPercentileWindows };
+
+
+//------------------------------------------------------------------------------------//
+// p50/p95/p99 of one value over the last hour, day and week.
+//------------------------------------------------------------------------------------//
+
+class PercentileTracker
+{
+public:
+  PercentileTracker() :
+    mWindows{{
+      WindowedQuantiles(3600, 12),           // 5 min slices
+      WindowedQuantiles(24 * 3600, 24),      // 1 h slices
+      WindowedQuantiles(7 * 24 * 3600, 28)   // 6 h slices
+    }}
+  {
+  }
+
+  void add(const double time, const double value)
+  {
+    for (auto& window : mWindows)
+    {
+      window.add(time, value);
+    }
+  }
+
+  Percentiles percentiles(const PercentileWindow window) const
+  {
+    const auto sketch = mWindows[window].sketch();
+    return {sketch.quantile(0.5), sketch.quantile(0.95), sketch.quantile(0.99),
+      sketch.count()};
+  }
+
+private:
+  std::array<WindowedQuantiles, kNumPercentileWindows> mWindows;
+};
+
+} // stats
+} // qst
+
+#endif /* quantilesketch_h */
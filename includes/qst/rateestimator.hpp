@@ -0,0 +1,164 @@
+/******************************************************************************
+ // QSyncthingTray
+ // Copyright (c) Matthias Frick, All rights reserved.
+ //
+ // This library is free software; you can redistribute it and/or
+ // modify it under the terms of the GNU Lesser General Public
+ // License as published by the Free Software Foundation; either
+ // version 3.0 of the License, or (at your option) any later version.
+ //
+ // This library is distributed in the hope that it will be useful,
+ // but WITHOUT ANY WARRANTY; without even the implied warranty of
+ // MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ // Lesser General Public License for more details.
+ //
+ // You should have received a copy of the GNU Lesser General Public
+ // License along with this library.
+ ******************************************************************************/
+
+#ifndef rateestimator_h
+#define rateestimator_h
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <limits>
+#include <utility>
+
+namespace qst
+{
+namespace stats
+{
+
+//------------------------------------------------------------------------------------//
+
+struct RateStatistics
+{
+  double current = 0;
+  double smoothed = 0;
+  double min = 0;
+  double avg = 0;
+  double max = 0;
+};
+
+// in / out
+using TrafficStatistics = std::pair<RateStatistics, RateStatistics>;
+
+
+//------------------------------------------------------------------------------------//
+// Turns a monotonically growing byte counter into a rate in bytes/s.
+// Deltas are taken on steady_clock so wall clock steps (NTP, manual changes)
+// never show up as spikes. A counter going backwards (Syncthing restarted)
+// or a repeated timestamp rebaselines instead of producing a negative or
+// infinite rate; the rate is 0 and smoothing starts over from there.
+//------------------------------------------------------------------------------------//
+
+class RateEstimator
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit RateEstimator(
+    const Clock::duration window = std::chrono::seconds(60),
+    const Clock::duration smoothingTime = std::chrono::seconds(3)) :
+      mWindow(window)
+    , mSmoothingTime(smoothingTime)
+  {
+  }
+
+  // returns false if the sample only (re)established the baseline
+  bool addSample(const std::uint64_t totalBytes, const Clock::time_point now)
+  {
+    using namespace std::chrono;
+    const bool hasBaseline = mHasBaseline;
+    const auto lastBytes = mLastBytes;
+    const auto lastTime = mLastTime;
+    mHasBaseline = true;
+    mLastBytes = totalBytes;
+    mLastTime = now;
+
+    if (!hasBaseline || totalBytes < lastBytes || now <= lastTime)
+    {
+      mCurrent = 0;
+      mSmoothed = 0;
+      mHasRate = false;
+      return false;
+    }
+
+    const double deltaSec = duration_cast<duration<double>>(now - lastTime).count();
+    mCurrent = static_cast<double>(totalBytes - lastBytes) / deltaSec;
+
+    // time aware EWMA, independent of the polling interval
+    const double tau = duration_cast<duration<double>>(mSmoothingTime).count();
+    const double alpha = tau > 0 ? 1.0 - std::exp(-deltaSec / tau) : 1.0;
+    mSmoothed = mHasRate ? mSmoothed + alpha * (mCurrent - mSmoothed) : mCurrent;
+    mHasRate = true;
+
+    mWindowSamples.emplace_back(now, mCurrent);
+    mWindowSum += mCurrent;
+    while (!mWindowSamples.empty() && mWindowSamples.front().first < now - mWindow)
+    {
+      mWindowSum -= mWindowSamples.front().second;
+      mWindowSamples.pop_front();
+    }
+    return true;
+  }
+
+  // samples older than the window are left out even if no newer sample
+  // pushed them out, e.g. while the counters could not be polled
+  auto statistics(const Clock::time_point now = Clock::now()) const -> RateStatistics
+  {
+    RateStatistics result;
+    result.current = mCurrent;
+    result.smoothed = mSmoothed;
+    auto first = mWindowSamples.begin();
+    double expiredSum = 0;
+    while (first != mWindowSamples.end() && first->first < now - mWindow)
+    {
+      expiredSum += first->second;
+      ++first;
+    }
+    if (first == mWindowSamples.end())
+    {
+      return result;
+    }
+    const auto minMax = std::minmax_element(first, mWindowSamples.end(),
+      [](const Sample& lhs, const Sample& rhs)
+      {
+        return lhs.second < rhs.second;
+      });
+    result.min = minMax.first->second;
+    result.max = minMax.second->second;
+    result.avg = (std::max)(0.0, (mWindowSum - expiredSum) /
+      std::distance(first, mWindowSamples.end()));
+    return result;
+  }
+
+  void reset()
+  {
+    *this = RateEstimator(mWindow, mSmoothingTime);
+  }
+
+private:
+  using Sample = std::pair<Clock::time_point, double>;
+
+  Clock::duration mWindow;
+  Clock::duration mSmoothingTime;
+  bool mHasBaseline = false;
+  bool mHasRate = false;
+  std::uint64_t mLastBytes = 0;
+  Clock::time_point mLastTime;
+  double mCurrent = 0;
+  double mSmoothed = 0;
+  std::deque<Sample> mWindowSamples;
+  double mWindowSum = 0;
+};
+
+} // stats
+} // qst
+
+#endif /* rateestimator_h */
@@ -0,0 +1,99 @@
+/******************************************************************************
+ // QSyncthingTray
+ // Copyright (c) Matthias Frick, All rights reserved.
+ //
+ // This library is free software; you can redistribute it and/or
+ // modify it under the terms of the GNU Lesser General Public
+ // License as published by the Free Software Foundation; either
+ // version 3.0 of the License, or (at your option) any later version.
+ //
+ // This library is distributed in the hope that it will be useful,
+ // but WITHOUT ANY WARRANTY; without even the implied warranty of
+ // MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ // Lesser General Public License for more details.
+ //
+ // You should have received a copy of the GNU Lesser General Public
+ // License along with this library.
+ ******************************************************************************/
+
+#ifndef slidingwindow_h
+#define slidingwindow_h
+#pragma once
+
+#include <deque>
+#include <utility>
+
+namespace qst
+{
+namespace stats
+{
+
+//------------------------------------------------------------------------------------//
+// Minimum and maximum over a time window that only grows at the back and
+// shrinks at the front. Both are kept as monotonic deques: a new sample
+// evicts every older one it dominates, since those can never become the
+// extreme again before it expires itself. push is amortized O(1), the
+// queries are O(1).
+//------------------------------------------------------------------------------------//
+
+class SlidingWindowExtrema
+{
+public:
+  // samples have to be pushed in time order
+  void push(const double time, const double value)
+  {
+    while (!mMax.empty() && mMax.back().second <= value)
+    {
+      mMax.pop_back();
+    }
+    mMax.emplace_back(time, value);
+    while (!mMin.empty() && mMin.back().second >= value)
+    {
+      mMin.pop_back();
+    }
+    mMin.emplace_back(time, value);
+  }
+
+  void expireBefore(const double time)
+  {
+    while (!mMax.empty() && mMax.front().first < time)
+    {
+      mMax.pop_front();
+    }
+    while (!mMin.empty() && mMin.front().first < time)
+    {
+      mMin.pop_front();
+    }
+  }
+
+  void clear()
+  {
+    mMax.clear();
+    mMin.clear();
+  }
+
+  bool empty() const
+  {
+    return mMax.empty();
+  }
+
+  double max() const
+  {
+    return mMax.front().second;
+  }
+
+  double min() const
+  {
+    return mMin.front().second;
+  }
+
+private:
+  using Sample = std::pair<double, double>;
+  std::deque<Sample> mMax;
+  std::deque<Sample> mMin;
+};
+
+} // stats
+} // qst
+
+#endif /* slidingwindow_h */
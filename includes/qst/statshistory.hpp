@@ -0,0 +1,374 @@
+/******************************************************************************
+ // QSyncthingTray
+ // Copyright (c) Matthias Frick, All rights reserved.
+ //
+ // This library is free software; you can redistribute it and/or
+ // modify it under the terms of the GNU Lesser General Public
+ // License as published by the Free Software Foundation; either
+ // version 3.0 of the License, or (at your option) any later version.
+ //
+ // This library is distributed in the hope that it will be useful,
+ // but WITHOUT ANY WARRANTY; without even the implied warranty of
+ // MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ // Lesser General Public License for more details.
+ //
+ // You should have received a copy of the GNU Lesser General Public
+ // License along with this library.
+ ******************************************************************************/
+
+#ifndef statshistory_h
+#define statshistory_h
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include "timeseries.hpp"
+
+namespace qst
+{
+namespace stats
+{
+
+//------------------------------------------------------------------------------------//
+
+struct TierSpec
+{
+  double resolution; // seconds per aggregated sample
+  double retention;  // seconds kept in this tier
+};
+
+// raw samples, then 10 s / 1 min / 10 min aggregates
+static const double kRawRetentionSec = 3600;
+// a pause longer than this (or three polls) is drawn as zero traffic
+static const double kMaxSecBeforeZero = 10;
+static const std::size_t kNumAggregateTiers = 3;
+static const std::array<TierSpec, kNumAggregateTiers> kAggregateTiers = {{
+  {10, 6 * 3600},
+  {60, 48 * 3600},
+  {600, 14 * 24 * 3600}
+}};
+
+enum Statistic { kMin, kAvg, kMax };
+
+
+//------------------------------------------------------------------------------------//
+// Multi resolution history. Every sample goes into the raw tier and into one
+// open bucket per aggregate tier; a bucket is rolled up into min/avg/max once
+// a sample for the next bucket arrives. Each tier is a bounded ring, so
+// memory does not depend on how long the history is.
+// Tier 0 is raw, tiers 1..N are the aggregates from kAggregateTiers. The open
+// bucket of an aggregate tier is exposed as its newest sample.
+// Gaps (suspend, lost connection, downtime) are detected once, against the
+// previous sample when a new one is appended, and bracketed by zero samples.
+//------------------------------------------------------------------------------------//
+
+template<std::size_t Columns>
+class StatsHistory
+{
+public:
+  using Values = std::array<double, Columns>;
+  static const std::size_t kNumTiers = kNumAggregateTiers + 1;
+  static const std::size_t kEnd = TimeSeriesRing<Columns>::kEnd;
+
+  // samples [first, last) of one tier
+  struct Slice
+  {
+    std::size_t tier;
+    std::size_t first;
+    std::size_t last;
+  };
+
+  explicit StatsHistory(const double sampleInterval = 1.0)
+  {
+    setSampleInterval(sampleInterval);
+    for (std::size_t tier = 0; tier < kNumAggregateTiers; ++tier)
+    {
+      const auto& spec = kAggregateTiers[tier];
+      mAggregates[tier].setCapacity(
+        static_cast<std::size_t>(std::ceil(spec.retention / spec.resolution)) + 2);
+    }
+  }
+
+  void setSampleInterval(const double sampleInterval)
+  {
+    // headroom for the zero points inserted around gaps
+    const auto samples = static_cast<std::size_t>(
+      std::ceil(kRawRetentionSec / sampleInterval));
+    mRaw.setCapacity(samples + samples / 4 + 16);
+    mMaxGap = (std::max)(kMaxSecBeforeZero, 3 * sampleInterval);
+  }
+
+  // Times have to increase: a sample not newer than the last one, e.g.
+  // after the wall clock was set back, is dropped, as the range queries
+  // and the graphs rely on sorted times. Returns false for a dropped one.
+  bool push(const double time, const Values& values)
+  {
+    if (!mRaw.empty() && !(time > mRaw.backTime()))
+    {
+      return false;
+    }
+    if (!mRaw.empty() && time - mRaw.backTime() > mMaxGap)
+    {
+      const Values zero{};
+      append(mRaw.backTime() + kMaxSecBeforeZero / 2, zero);
+      append(time - kMaxSecBeforeZero / 2, zero);
+    }
+    append(time, values);
+    return true;
+  }
+
+  bool empty() const
+  {
+    return mRaw.empty();
+  }
+
+  double lastTime() const
+  {
+    return mRaw.backTime();
+  }
+
+  // oldest sample still kept in any tier
+  double firstTime() const
+  {
+    return (std::min)(frontTime(0), frontTime(kNumTiers - 1));
+  }
+
+  // finest tier that still covers everything recorded after 'from' and
+  // returns at most maxPoints samples for it
+  std::size_t selectTier(const double from, const std::size_t maxPoints) const
+  {
+    return selectTier(from, std::numeric_limits<double>::infinity(), maxPoints);
+  }
+
+  // the same for the samples recorded in [from, to]
+  std::size_t selectTier(const double from, const double to,
+    const std::size_t maxPoints) const
+  {
+    const auto start = (std::max)(from, mFirstTime);
+    for (std::size_t tier = 0; tier < kNumTiers; ++tier)
+    {
+      const bool covers = size(tier) > 0 &&
+        frontTime(tier) <= start + resolution(tier);
+      const auto points = upperBound(tier, to) - lowerBound(tier, from);
+      if (covers && points <= maxPoints)
+      {
+        return tier;
+      }
+    }
+    return kNumTiers - 1;
+  }
+
+  // Range query for a view of [from, to]: the finest tier with at most
+  // maxPoints samples in it, and the samples inside plus one neighbour on
+  // each side so the lines run on to the edges of the view. Only binary
+  // searches, independent of how much history is kept.
+  Slice slice(const double from, const double to, const std::size_t maxPoints) const
+  {
+    const auto tier = selectTier(from, to, maxPoints);
+    const auto first = lowerBound(tier, from);
+    const auto last = (std::min)(upperBound(tier, to) + 1, size(tier));
+    return {tier, first > 0 ? first - 1 : 0, last};
+  }
+
+  double resolution(const std::size_t tier) const
+  {
+    return tier == 0 ? 0 : kAggregateTiers[tier - 1].resolution;
+  }
+
+  std::size_t size(const std::size_t tier) const
+  {
+    if (tier == 0)
+    {
+      return mRaw.size();
+    }
+    return mAggregates[tier - 1].size() + (mBuckets[tier - 1].count > 0 ? 1 : 0);
+  }
+
+  // samples that will not change anymore, i.e. without the open bucket
+  std::size_t closedSize(const std::size_t tier) const
+  {
+    return tier == 0 ? mRaw.size() : mAggregates[tier - 1].size();
+  }
+
+  double time(const std::size_t tier, const std::size_t idx) const
+  {
+    if (tier == 0)
+    {
+      return mRaw.time(idx);
+    }
+    const auto& ring = mAggregates[tier - 1];
+    return idx < ring.size() ? ring.time(idx) : mBuckets[tier - 1].time();
+  }
+
+  double value(const std::size_t tier, const std::size_t col,
+    const Statistic stat, const std::size_t idx) const
+  {
+    if (tier == 0)
+    {
+      return mRaw.value(col, idx);
+    }
+    const auto& ring = mAggregates[tier - 1];
+    return idx < ring.size() ? ring.value(column(col, stat), idx) :
+      mBuckets[tier - 1].values()[column(col, stat)];
+  }
+
+  double frontTime(const std::size_t tier) const
+  {
+    return time(tier, 0);
+  }
+
+  double backTime(const std::size_t tier) const
+  {
+    return time(tier, size(tier) - 1);
+  }
+
+  // index of the first sample after the given time
+  std::size_t upperBound(const std::size_t tier, const double time) const
+  {
+    return lowerBound(tier, std::nextafter(time, std::numeric_limits<double>::infinity()));
+  }
+
+  std::size_t lowerBound(const std::size_t tier, const double time) const
+  {
+    if (tier == 0)
+    {
+      return mRaw.lowerBound(time);
+    }
+    const auto& ring = mAggregates[tier - 1];
+    const auto idx = ring.lowerBound(time);
+    return idx < ring.size() || this->time(tier, idx) >= time ? idx : size(tier);
+  }
+
+  // samples [first, last) of a tier, the open bucket being the last one
+  template<typename OutIt>
+  OutIt copyTimes(const std::size_t tier, OutIt out, const std::size_t first = 0,
+    const std::size_t last = kEnd) const
+  {
+    if (tier == 0)
+    {
+      return mRaw.copyTimes(out, first, last);
+    }
+    out = mAggregates[tier - 1].copyTimes(out, first, last);
+    if (includesBucket(tier, first, last))
+    {
+      *out++ = mBuckets[tier - 1].time();
+    }
+    return out;
+  }
+
+  template<typename OutIt>
+  OutIt copyColumn(const std::size_t tier, const std::size_t col, const Statistic stat,
+    OutIt out, const std::size_t first = 0, const std::size_t last = kEnd) const
+  {
+    if (tier == 0)
+    {
+      return mRaw.copyColumn(col, out, first, last);
+    }
+    out = mAggregates[tier - 1].copyColumn(column(col, stat), out, first, last);
+    if (includesBucket(tier, first, last))
+    {
+      *out++ = mBuckets[tier - 1].values()[column(col, stat)];
+    }
+    return out;
+  }
+
+  std::size_t memoryUsage() const
+  {
+    std::size_t bytes = mRaw.memoryUsage();
+    for (const auto& ring : mAggregates)
+    {
+      bytes += ring.memoryUsage();
+    }
+    return bytes;
+  }
+
+private:
+  using AggregateRing = TimeSeriesRing<Columns * 3>;
+
+  static std::size_t column(const std::size_t col, const Statistic stat)
+  {
+    return col * 3 + stat;
+  }
+
+  bool includesBucket(const std::size_t tier, const std::size_t first,
+    const std::size_t last) const
+  {
+    const auto closed = mAggregates[tier - 1].size();
+    return mBuckets[tier - 1].count > 0 && first <= closed && closed < last;
+  }
+
+  void append(const double time, const Values& values)
+  {
+    mFirstTime = mFirstTime == 0 ? time : mFirstTime;
+    mRaw.push(time, values);
+    mRaw.expireBefore(time - kRawRetentionSec);
+    for (std::size_t tier = 0; tier < kNumAggregateTiers; ++tier)
+    {
+      const auto& spec = kAggregateTiers[tier];
+      auto& bucket = mBuckets[tier];
+      const auto bucketIdx = std::floor(time / spec.resolution);
+      if (bucket.count > 0 && bucketIdx != bucket.index)
+      {
+        mAggregates[tier].push(bucket.time(), bucket.values());
+        mAggregates[tier].expireBefore(time - spec.retention);
+        bucket = Bucket();
+      }
+      bucket.index = bucketIdx;
+      bucket.add(time, values);
+    }
+  }
+
+  struct Bucket
+  {
+    double index = 0;
+    std::size_t count = 0;
+    double timeSum = 0;
+    Values sum{};
+    Values min{};
+    Values max{};
+
+    void add(const double t, const Values& v)
+    {
+      for (std::size_t col = 0; col < Columns; ++col)
+      {
+        min[col] = count == 0 ? v[col] : (std::min)(min[col], v[col]);
+        max[col] = count == 0 ? v[col] : (std::max)(max[col], v[col]);
+        sum[col] += v[col];
+      }
+      timeSum += t;
+      ++count;
+    }
+
+    // mean sample time, so the open bucket never lies in the future
+    double time() const
+    {
+      return timeSum / count;
+    }
+
+    typename AggregateRing::Values values() const
+    {
+      typename AggregateRing::Values result;
+      for (std::size_t col = 0; col < Columns; ++col)
+      {
+        result[column(col, kMin)] = min[col];
+        result[column(col, kAvg)] = sum[col] / count;
+        result[column(col, kMax)] = max[col];
+      }
+      return result;
+    }
+  };
+
+  TimeSeriesRing<Columns> mRaw;
+  std::array<AggregateRing, kNumAggregateTiers> mAggregates;
+  std::array<Bucket, kNumAggregateTiers> mBuckets;
+  double mFirstTime = 0;
+  double mMaxGap = kMaxSecBeforeZero;
+};
+
+} // stats
+} // qst
+
+#endif /* statshistory_h */
@@ -0,0 +1,246 @@
+/******************************************************************************
+ // QSyncthingTray
+ // Copyright (c) Matthias Frick, All rights reserved.
+ //
+ // This library is free software; you can redistribute it and/or
+ // modify it under the terms of the GNU Lesser General Public
+ // License as published by the Free Software Foundation; either
+ // version 3.0 of the License, or (at your option) any later version.
+ //
+ // This library is distributed in the hope that it will be useful,
+ // but WITHOUT ANY WARRANTY; without even the implied warranty of
+ // MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ // Lesser General Public License for more details.
+ //
+ // You should have received a copy of the GNU Lesser General Public
+ // License along with this library.
+ ******************************************************************************/
+
+#ifndef statsplot_h
+#define statsplot_h
+#pragma once
+
+#include <QColor>
+#include <QFont>
+#include <QString>
+#include <QStringList>
+#include <algorithm>
+#include <vector>
+#include <contrib/qcustomplot.h>
+#include "lttb.hpp"
+#include "statshistory.hpp"
+
+namespace qst
+{
+namespace stats
+{
+
+//------------------------------------------------------------------------------------//
+// Look and graph layout of the stats plots, shared between StatsWidget and
+// the render benchmark so both draw exactly the same thing.
+//------------------------------------------------------------------------------------//
+
+static const QBrush kPlotBackgroundColor{QColor(0,0,0,255)};
+static const QColor kPlotForegroundColor{255,255,255,255};
+
+inline void configureStatsPlot(QCustomPlot* plot, const QString& title,
+  const QSharedPointer<QCPAxisTicker>& ticker, const QFont& font)
+{
+  plot->yAxis->setNumberFormat("f");
+  plot->yAxis->setNumberPrecision(1);
+  plot->xAxis->setTicker(ticker);
+  plot->xAxis->setLabelColor(kPlotForegroundColor);
+  plot->yAxis->setLabelColor(kPlotForegroundColor);
+  plot->xAxis->setTickLabelColor(kPlotForegroundColor);
+  plot->yAxis->setTickLabelColor(kPlotForegroundColor);
+  plot->setBackground(kPlotBackgroundColor);
+  plot->legend->setFont(QFont(font.family(), 7));
+  plot->legend->setIconSize(15, 10);
+  plot->legend->setVisible(true);
+  plot->legend->setTextColor(kPlotForegroundColor);
+  plot->legend->setBrush(kPlotBackgroundColor);
+  plot->legend->setBorderPen(QPen(kPlotForegroundColor));
+  plot->xAxis->grid()->setVisible(true);
+  plot->xAxis->grid()->setPen(QPen(kPlotForegroundColor, 0, Qt::DotLine));
+  plot->yAxis->grid()->setVisible(true);
+  plot->yAxis->grid()->setPen(QPen(kPlotForegroundColor, 0, Qt::DotLine));
+  plot->xAxis->setBasePen(QPen(kPlotForegroundColor, 0, Qt::SolidLine));
+  plot->yAxis->setBasePen(QPen(kPlotForegroundColor, 0, Qt::SolidLine));
+
+  plot->setMinimumWidth(400);
+  plot->setMinimumHeight(200);
+  plot->plotLayout()->insertRow(0);
+  plot->plotLayout()->addElement(0, 0,
+    new QCPTextElement(plot, title));
+  auto textElement = dynamic_cast<QCPTextElement*>(
+    plot->plotLayout()->element(0, 0));
+  textElement->setTextColor(kPlotForegroundColor);
+}
+
+
+//------------------------------------------------------------------------------------//
+
+// graph(0) is outgoing, graph(1) incoming traffic
+inline void addTrafficGraphs(QCustomPlot* plot)
+{
+  plot->addGraph();
+  plot->addGraph();
+
+  plot->graph(0)->setPen(QPen(QColor(255, 0, 0, 255)));
+  plot->graph(0)->setName("Output");
+  plot->graph(1)->setPen(QPen(QColor(0, 255, 255, 255)));
+  plot->graph(1)->setName("Input");
+  plot->xAxis->setLabel("Time");
+  plot->yAxis->setLabel("kb/s");
+}
+
+
+//------------------------------------------------------------------------------------//
+
+static const char* const kStripLayerName = "strip";
+
+// Layers of a stats plot, each group on a paint buffer of its own:
+// background, title and legend only change with the style, grid and axes
+// with the visible range, and the graphs on the strip layer with the data.
+// A redraw then only repaints the groups that changed, see QCPLayer::replot.
+inline QCPLayer* setupStatsLayers(QCustomPlot* plot)
+{
+  // the title lives on "main", below the grid it shares the background buffer
+  plot->moveLayer(plot->layer("main"), plot->layer("grid"), QCustomPlot::limBelow);
+  plot->layer("grid")->setMode(QCPLayer::lmBuffered);
+  plot->addLayer(kStripLayerName, plot->layer("grid"), QCustomPlot::limAbove);
+  const auto layer = plot->layer(kStripLayerName);
+  layer->setMode(QCPLayer::lmBuffered);
+  for (int graph = 0; graph < plot->graphCount(); ++graph)
+  {
+    plot->graph(graph)->setLayer(layer);
+  }
+  plot->layer("axes")->setMode(QCPLayer::lmBuffered);
+  plot->layer("legend")->setMode(QCPLayer::lmBuffered);
+  return layer;
+}
+
+
+//------------------------------------------------------------------------------------//
+
+// debug overlay in the top left corner of the plot, see repaintCounts
+inline QCPItemText* addRepaintOverlay(QCustomPlot* plot)
+{
+  const auto text = new QCPItemText(plot);
+  text->setLayer("overlay");
+  text->position->setType(QCPItemPosition::ptAxisRectRatio);
+  text->position->setCoords(0.01, 0.02);
+  text->setPositionAlignment(Qt::AlignLeft | Qt::AlignTop);
+  text->setTextAlignment(Qt::AlignLeft);
+  text->setColor(kPlotForegroundColor);
+  text->setFont(QFont(plot->font().family(), 7));
+  return text;
+}
+
+// how often each layer was drawn into its paint buffer, bottom layer first
+inline QString repaintCounts(const QCustomPlot* plot)
+{
+  QStringList counts;
+  for (int idx = 0; idx < plot->layerCount(); ++idx)
+  {
+    const auto layer = plot->layer(idx);
+    counts << QString("%1: %2").arg(layer->name()).arg(layer->repaintCount());
+  }
+  return counts.join("\n");
+}
+
+
+//------------------------------------------------------------------------------------//
+
+// drag to pan and wheel to zoom along the time axis only
+inline void enableHistoryBrowsing(QCustomPlot* plot)
+{
+  plot->setInteractions(QCP::iRangeDrag | QCP::iRangeZoom);
+  plot->axisRect()->setRangeDrag(Qt::Horizontal);
+  plot->axisRect()->setRangeZoom(Qt::Horizontal);
+}
+
+// Replaces the graph data with a slice of a history, see StatsHistory::slice,
+// reduced with LTTB to about maxPoints, and returns the range of the values.
+// graphColumns maps each graph to a column of the history. Of an aggregate
+// tier the bucket maxima are shown, the averages would flatten the spikes.
+template<typename Series>
+QCPRange loadHistorySlice(QCustomPlot* plot, const Series& series,
+  const typename Series::Slice& slice, const std::vector<std::size_t>& graphColumns,
+  const QCPRange& keyRange, const std::size_t maxPoints)
+{
+  const auto count = static_cast<int>(slice.last - slice.first);
+  QVector<double> time(count), values(count), plotTime, plotValues;
+  series.copyTimes(slice.tier, time.begin(), slice.first, slice.last);
+  QCPRange valueRange(0, 0);
+  for (std::size_t graph = 0; graph < graphColumns.size(); ++graph)
+  {
+    series.copyColumn(slice.tier, graphColumns[graph], kMax, values.begin(),
+      slice.first, slice.last);
+    if (static_cast<std::size_t>(count) > maxPoints)
+    {
+      LttbDecimator decimator(keyRange.size() / maxPoints);
+      plotTime.clear();
+      plotValues.clear();
+      for (int idx = 0; idx < count; ++idx)
+      {
+        decimator.push(time[idx], values[idx], plotTime, plotValues);
+      }
+      decimator.pending(plotTime, plotValues);
+    }
+    else
+    {
+      plotTime = time;
+      plotValues = values;
+    }
+    for (const auto value : plotValues)
+    {
+      valueRange.lower = (std::min)(valueRange.lower, value);
+      valueRange.upper = (std::max)(valueRange.upper, value);
+    }
+    plot->graph(static_cast<int>(graph))->setData(plotTime, plotValues, true);
+  }
+  return valueRange;
+}
+
+
+//------------------------------------------------------------------------------------//
+
+inline void addConnectionGraphs(QCustomPlot* plot)
+{
+  plot->addGraph();
+
+  plot->graph(0)->setPen(QPen(QColor(255, 0, 0, 255)));
+  plot->graph(0)->setName("Active Connections");
+  plot->xAxis->setLabel("Time");
+  plot->yAxis->setLabel("Connections");
+}
+
+
+//------------------------------------------------------------------------------------//
+
+// one graph per folder slot, the last for all other folders; each is
+// filled down to the one before it, so with cumulative values they stack
+inline void addFolderGraphs(QCustomPlot* plot, const int count)
+{
+  for (int graph = 0; graph < count; ++graph)
+  {
+    plot->addGraph();
+    auto color = graph + 1 < count ?
+      QColor::fromHsv(graph * 300 / count, 255, 255) : QColor(160, 160, 160);
+    plot->graph(graph)->setPen(QPen(color));
+    color.setAlpha(96);
+    plot->graph(graph)->setBrush(QBrush(color));
+    if (graph > 0)
+    {
+      plot->graph(graph)->setChannelFillGraph(plot->graph(graph - 1));
+    }
+  }
+  plot->xAxis->setLabel("Time");
+  plot->yAxis->setLabel("kb/s");
+}
+
+} // stats
+} // qst
+
+#endif /* statsplot_h */
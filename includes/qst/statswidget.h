@@ -30,21 +30,26 @@
 #include <QProcess>
 #include <QWidget>
 #include <QString>
+#include <algorithm>
+#include <array>
 #include <memory>
 #include <cstdint>
 #include <functional>
-#include <list>
-#include <mutex>
+#include <thread>
 #include <utility>
+#include <vector>
 #include "platforms.hpp"
 #include "apihandler.hpp"
+#include "historylog.h"
+#include "lttb.hpp"
+#include "plotrasterizer.h"
+#include "quantilesketch.hpp"
+#include "slidingwindow.hpp"
+#include "statshistory.hpp"
+#include "transferattribution.hpp"
 #include <contrib/qcustomplot.h>
 #include <qst/appsettings.hpp>
 
-namespace
-{
-  using ConnectionPlotData = std::tuple<std::uint16_t, std::chrono::time_point<std::chrono::system_clock>>;
-}
 namespace qst
 {
 namespace stats
@@ -58,44 +63,194 @@ public:
   StatsWidget() = delete;
   StatsWidget(const QString& title,
     std::shared_ptr<settings::AppSettings> appSettings);
+  ~StatsWidget();
   void updateTrafficData(const TrafficData& traffData);
   void addConnectionPoint(const std::uint16_t& numConn);
+  // kb/s per folder id, busiest first, labelled with the folder names
+  void updateFolderTraffic(const std::vector<TransferRate>& folders);
   void closeEvent(QCloseEvent * event);
+  void changeEvent(QEvent* event);
+  void resizeEvent(QResizeEvent* event);
+
+  // samples queued for the history, and samples merged into another one
+  // because too many were waiting
+  std::uint64_t handedOffSamples() const;
+  std::uint64_t coalescedSamples() const;
+  // plot redraws skipped because nothing changed or nothing was visible
+  std::uint64_t avoidedReplots() const;
+  // graph frames that were scrolled with only the new strip drawn, and
+  // frames that were superseded before they were shown
+  std::uint64_t scrolledFrames() const;
+  std::uint64_t droppedFrames() const;
 
 public slots:
   void show();
 
 private slots:
   void updatePlot();
+  void drainSamples();
+  void finishHistoryLoad();
   void onSettingsChanged();
 
 private:
-  void configurePlot(QCustomPlot* plot, const QString& title);
   void updateTitle(QCustomPlot* plot, const QString& title);
+  void setKeyRange(QCustomPlot* plot, const QCPRange& range);
+  void browse(const QCPRange& range);
+  void stopBrowsing();
   void updateTrafficPlot();
   void updateConnectionsPlot();
+  void updateFoldersPlot();
+  void loadFolderSlice(const QCPRange& range);
+  QString folderLabel(const std::size_t slot, const QCPRange& range) const;
+  void resizeSeries();
+  bool isPlotExposed() const;
+  void updatePercentiles();
+  int redrawInterval() const;
+  void startHistoryLoad();
+  void handOff(const HistoryRecord& record);
+  std::size_t maxPlotPoints(const QCustomPlot* plot) const;
+  void reserveGraphPoints(QCustomPlot* plot, const std::size_t maxPoints) const;
+
+  // what has already been handed to a plot's graphs
+  struct PlotFeed
+  {
+    std::size_t tier = StatsHistory<1>::kNumTiers;
+    double bucketWidth = 0;
+    double lastClosedTime = 0;
+    // graph lines from this time on were replaced by the last feed
+    double firstChangedTime = 0;
+    // per graph: the decimator, the extrema of the points it settled on and
+    // the range of the undecided tail, which is replaced on every redraw
+    std::vector<LttbDecimator> decimators;
+    std::vector<double> lastSettledTime;
+    std::vector<SlidingWindowExtrema> extrema;
+    std::vector<double> tailMin;
+    std::vector<double> tailMax;
 
-  template<typename Container, typename Duration>
-  void cleanupTimeData(Container& vec, const Duration& dur);
+    double maxValue() const
+    {
+      double result = 0;
+      for (std::size_t graph = 0; graph < extrema.size(); ++graph)
+      {
+        result = extrema[graph].empty() ? result : (std::max)(result, extrema[graph].max());
+        result = (std::max)(result, tailMax[graph]);
+      }
+      return result;
+    }
 
-  template<typename Container>
-  void zeroMissingTimeData(Container& vec);
+    double minValue() const
+    {
+      double result = 0;
+      for (std::size_t graph = 0; graph < extrema.size(); ++graph)
+      {
+        result = extrema[graph].empty() ? result : (std::min)(result, extrema[graph].min());
+        result = (std::min)(result, tailMin[graph]);
+      }
+      return result;
+    }
+  };
+
+  template<typename Series>
+  bool feedPlot(QCustomPlot* plot, const Series& series, PlotFeed& feed,
+    const std::vector<std::size_t>& graphColumns);
+  template<typename Series>
+  void browsePlot(QCustomPlot* plot, const Series& series, PlotFeed& feed,
+    const std::vector<std::size_t>& graphColumns, PlotRasterizer& rasterizer);
+  void requestFrame(QCustomPlot* plot, const PlotFeed& feed,
+    PlotRasterizer& rasterizer);
+  void showFrame(QCustomPlot* plot, PlotFrameLayerable* frameLayerable,
+    const PlotFrame& frame);
+  void updateRepaintOverlay(QCustomPlot* plot, QCPItemText* overlay);
 
   QString mTitle;
   std::shared_ptr<settings::AppSettings> mpAppSettings;
   QTimer mRedrawTimer;
   QLabel *mpLabel;
+  QLabel *mpPercentileLabel;
   QWidget *mpWidget;
-  std::mutex mDataGuard;
   QCustomPlot *mpCustomPlot;
   QCustomPlot *mpConnectionPlot;
+  // drawn by QCustomPlot itself, a few stacked fills do not need a worker
+  QCustomPlot *mpFolderPlot;
+  // the graphs only hold the data and the legend entries, they are drawn
+  // by the rasterizers and shown through the frame layerables
+  PlotRasterizer mTrafficRasterizer;
+  PlotRasterizer mConnectionRasterizer;
+  PlotFrameLayerable *mpTrafficFrame;
+  PlotFrameLayerable *mpConnectionFrame;
+  // per layer repaint counts, only shown with QST_STATS_DEBUG set
+  QCPItemText *mpTrafficOverlay = nullptr;
+  QCPItemText *mpConnectionOverlay = nullptr;
   QSharedPointer<QCPAxisTickerDateTime> mpDateTicker;
-  std::list<TrafficData> mTrafficPoints;
-  std::list<ConnectionPlotData> mConnectionPoints;
+  enum TrafficColumn { kInColumn, kOutColumn };
+  // what the history log holds, the live samples are added to it as well
+  struct SampleHistory
+  {
+    StatsHistory<2> traffic;
+    StatsHistory<1> connections;
+    PercentileTracker inPercentiles;
+    PercentileTracker outPercentiles;
+    PercentileTracker connectionPercentiles;
+
+    // false for a sample going back in time, see StatsHistory::push
+    bool add(const HistoryRecord& record);
+  };
+  SampleHistory mHistory;
+  // the busiest folders keep their column for as long as they stay among
+  // the busiest, the last column sums up all others
+  static const std::size_t kNumFolderSlots = 4;
+  StatsHistory<kNumFolderSlots + 1> mFolderSeries;
+  // folder id per column
+  std::array<QString, kNumFolderSlots> mFolderSlots;
+  // which folder a column showed from a time on, oldest first; a column
+  // keeps the samples of its earlier folders for as long as they are retained
+  struct FolderSegment
+  {
+    double start;
+    QString label;
+  };
+  std::array<std::vector<FolderSegment>, kNumFolderSlots> mFolderSegments;
+  PlotFeed mTrafficFeed;
+  PlotFeed mConnectionFeed;
+  // buffers for the samples appended per redraw, reused across redraws
+  QVector<double> mFeedTime, mFeedValues;
+  QVector<double> mPlotTime, mPlotValues;
+  HistoryLog mHistoryLog;
+  // the log is replayed on mHistoryLoader into mLoadedHistory, which
+  // finishHistoryLoad swaps in; until then live samples wait in mLoadBacklog
+  std::thread mHistoryLoader;
+  std::unique_ptr<SampleHistory> mLoadedHistory;
+  std::vector<HistoryRecord> mLoadBacklog;
+
+  // samples waiting for the next drain; once kMaxPendingSamples wait, the
+  // samples of a series are averaged into its overflow sample, which is
+  // drained after the queued ones
+  struct PendingSample
+  {
+    HistoryRecord record;
+    std::uint32_t count = 0;
+  };
+  static const std::size_t kMaxPendingSamples = 1024;
+  std::vector<HistoryRecord> mPendingSamples;
+  std::array<PendingSample, 2> mOverflow;
+  bool mDrainScheduled = false;
+  std::uint64_t mHandedOff = 0;
+  std::uint64_t mCoalesced = 0;
   int mMaxTimeInPlotMins = 60;
-  static const int kMaxSecBeforeZero;
-  static const QBrush kBackgroundColor;
-  static const QColor kForegroundColor;
+  // while browsing, both plots show mBrowseRange instead of following the
+  // live data; mSettingRange marks range changes that are not the user's
+  bool mBrowsing = false;
+  bool mSettingRange = false;
+  QCPRange mBrowseRange;
+  bool mTrafficDirty = true;
+  bool mConnectionsDirty = true;
+  bool mFoldersDirty = true;
+  std::uint64_t mAvoidedReplots = 0;
+  static const int kMinRedrawIntervalMs;
+  static const int kMaxRedrawIntervalMs;
+  static const double kMinPollIntervalSec;
+  static const std::size_t kDecimationOversampling;
+  static const double kMinBrowseSpanSec;
 };
 
 } // stats namespace
@@ -0,0 +1,105 @@
+/******************************************************************************
+ // QSyncthingTray
+ // Copyright (c) Matthias Frick, All rights reserved.
+ //
+ // This library is free software; you can redistribute it and/or
+ // modify it under the terms of the GNU Lesser General Public
+ // License as published by the Free Software Foundation; either
+ // version 3.0 of the License, or (at your option) any later version.
+ //
+ // This library is distributed in the hope that it will be useful,
+ // but WITHOUT ANY WARRANTY; without even the implied warranty of
+ // MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ // Lesser General Public License for more details.
+ //
+ // You should have received a copy of the GNU Lesser General Public
+ // License along with this library.
+ ******************************************************************************/
+
+#ifndef synccompletion_h
+#define synccompletion_h
+#pragma once
+
+#include <QHash>
+#include <QJsonObject>
+#include <QSet>
+#include <QString>
+#include <algorithm>
+
+namespace qst
+{
+namespace stats
+{
+
+//------------------------------------------------------------------------------------//
+// Overall completion of the local folders, from the FolderSummary events
+// Syncthing sends whenever the state of a folder changed. Folders without
+// a summary yet count as in sync; folders removed from the configuration
+// are dropped with retainFolders.
+//------------------------------------------------------------------------------------//
+
+class SyncCompletion
+{
+public:
+  void processEvent(const QJsonObject& event)
+  {
+    if (event["type"].toString() != "FolderSummary")
+    {
+      return;
+    }
+    const auto data = event["data"].toObject();
+    const auto summary = data["summary"].toObject();
+    FolderBytes bytes;
+    bytes.global = summary["globalBytes"].toDouble();
+    bytes.need = summary["needBytes"].toDouble();
+    mFolders.insert(data["folder"].toString(), bytes);
+  }
+
+  // share of the bytes in sync over all folders, 1 when nothing is needed
+  double completion() const
+  {
+    double global = 0;
+    double need = 0;
+    for (const auto& bytes : mFolders)
+    {
+      global += bytes.global;
+      need += bytes.need;
+    }
+    return need > 0 && global > 0 ? 1.0 - (std::min)(need / global, 1.0) : 1.0;
+  }
+
+  // drops the summaries of all folders not in 'ids'
+  void retainFolders(const QSet<QString>& ids)
+  {
+    for (auto it = mFolders.begin(); it != mFolders.end();)
+    {
+      if (!ids.contains(it.key()))
+      {
+        it = mFolders.erase(it);
+      }
+      else
+      {
+        ++it;
+      }
+    }
+  }
+
+  void clear()
+  {
+    mFolders.clear();
+  }
+
+private:
+  struct FolderBytes
+  {
+    double global = 0;
+    double need = 0;
+  };
+
+  QHash<QString, FolderBytes> mFolders;
+};
+
+} // stats
+} // qst
+
+#endif /* synccompletion_h */
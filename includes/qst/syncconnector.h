@@ -28,6 +28,7 @@
 #include <QAuthenticator>
 #include <QNetworkReply>
 #include <QProcess>
+#include <QPointer>
 #include <memory>
 #include <cstdint>
 #include <functional>
@@ -36,6 +37,9 @@
 #include <utility>
 #include "platforms.hpp"
 #include "apihandler.hpp"
+#include "jsonstreamreader.hpp"
+#include "synccompletion.hpp"
+#include "transferattribution.hpp"
 #include <qst/appsettings.hpp>
 #include <qst/webview.h>
 
@@ -71,8 +75,13 @@ namespace connector
     void setURL(QUrl url, const QString& userName, const QString& password);
     void showWebView();
     void shutdownSyncthingProcess();
-    std::list<FolderNameFullPath> getFolders();
-    LastSyncedFileList getLastSyncedFiles();
+    const std::list<FolderNameFullPath>& getFolders();
+    const LastSyncedFileList& getLastSyncedFiles();
+    stats::TrafficStatistics getTrafficStatistics();
+    // busiest folders by id, in kbyte/s
+    std::vector<stats::TransferRate> getFolderTraffic(const std::size_t count);
+    // 0..1 over all folders, 1 when everything is in sync
+    double getSyncCompletion();
     void pauseSyncthing(bool paused);
     webview::WebView *getWebView();
 
@@ -83,6 +92,7 @@ namespace connector
   private slots:
     void onSslError(QNetworkReply* reply);
     void netRequestfinished(QNetworkReply *reply);
+    void replyDataAvailable(QNetworkReply *reply);
     void checkConnectionHealth();
     void shutdownProcessPosted(QNetworkReply *reply);
     void testUrlAvailability();
@@ -92,12 +102,17 @@ namespace connector
   private:
     void ignoreSslErrors(QNetworkReply *reply);
     void getCurrentConfig();
+    auto takeReplyData(QNetworkReply *reply) -> QJsonObject;
     void resetNetworkAccessManager();
     bool checkIfFileExists(QString path);
     void urlTested(QNetworkReply* reply);
     void connectionHealthReceived(QNetworkReply* reply);
     void currentConfigReceived(QNetworkReply* reply);
     void lastSyncedFilesReceived(QNetworkReply *reply);
+    void requestEvents();
+    void eventsReceived(QNetworkReply *reply);
+    void requestFileSizes();
+    void fileInfoReceived(QNetworkReply *reply);
     int getCurrentVersion(QString reply);
     std::uint16_t mConnectionHealthTime = 1000;
     bool didShowSSLWarning;
@@ -116,13 +131,24 @@ namespace connector
       connectionHealth,
       getCurrentConfig,
       getLastSyncedFiles,
+      events,
+      fileInfo,
       shutdownRequested
     };
     QHash<QNetworkReply*, kRequestMethod> requestMap;
+    void trackReply(QNetworkReply *reply, kRequestMethod method);
+
+    //! Replies are parsed incrementally while they download
+    QHash<QNetworkReply*, std::shared_ptr<api::JsonStreamReader>> mReplyReaders;
 
     std::unique_ptr<webview::WebView> mpSyncWebView;
     std::list<FolderNameFullPath> mFolders;
     LastSyncedFileList mLastSyncedFiles;
+    stats::TrafficStatistics mTrafficStatistics;
+    //! Long poll on the event stream, restarted by the health check if lost
+    QPointer<QNetworkReply> mpEventsReply;
+    stats::TransferAttribution mTransferAttribution;
+    stats::SyncCompletion mSyncCompletion;
     std::unique_ptr<QTimer> mpConnectionHealthTimer;
     std::unique_ptr<QTimer> mpConnectionAvailabilityTimer;
     std::pair<QString, QString> mAuthentication;
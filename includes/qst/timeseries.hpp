@@ -0,0 +1,213 @@
+/******************************************************************************
+ // QSyncthingTray
+ // Copyright (c) Matthias Frick, All rights reserved.
+ //
+ // This library is free software; you can redistribute it and/or
+ // modify it under the terms of the GNU Lesser General Public
+ // License as published by the Free Software Foundation; either
+ // version 3.0 of the License, or (at your option) any later version.
+ //
+ // This library is distributed in the hope that it will be useful,
+ // but WITHOUT ANY WARRANTY; without even the implied warranty of
+ // MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ // Lesser General Public License for more details.
+ //
+ // You should have received a copy of the GNU Lesser General Public
+ // License along with this library.
+ ******************************************************************************/
+
+#ifndef timeseries_h
+#define timeseries_h
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+namespace qst
+{
+namespace stats
+{
+
+//------------------------------------------------------------------------------------//
+// Fixed capacity time series stored as structure of arrays.
+// One contiguous array for the time stamps (seconds since epoch) and one per
+// value column. Once full, pushing overwrites the oldest sample, so memory is
+// bounded by the capacity no matter how long the application runs.
+// Indices passed to the accessors are chronological, 0 being the oldest.
+//------------------------------------------------------------------------------------//
+
+template<std::size_t Columns>
+class TimeSeriesRing
+{
+public:
+  using Values = std::array<double, Columns>;
+  static const std::size_t kEnd = static_cast<std::size_t>(-1);
+
+  explicit TimeSeriesRing(const std::size_t capacity = 0)
+  {
+    setCapacity(capacity);
+  }
+
+  // keeps the newest samples that still fit
+  void setCapacity(const std::size_t capacity)
+  {
+    if (capacity == mCapacity)
+    {
+      return;
+    }
+    const std::size_t keep = (std::min)(mSize, capacity);
+    std::vector<double> time(capacity);
+    std::array<std::vector<double>, Columns> columns;
+    for (std::size_t col = 0; col < Columns; ++col)
+    {
+      columns[col].resize(capacity);
+      copyColumn(col, columns[col].begin(), mSize - keep);
+    }
+    copyTimes(time.begin(), mSize - keep);
+    mTime.swap(time);
+    mColumns.swap(columns);
+    mCapacity = capacity;
+    mSize = keep;
+    mHead = 0;
+  }
+
+  void push(const double time, const Values& values)
+  {
+    if (mCapacity == 0)
+    {
+      return;
+    }
+    const std::size_t pos = physical(mSize == mCapacity ? 0 : mSize);
+    mTime[pos] = time;
+    for (std::size_t col = 0; col < Columns; ++col)
+    {
+      mColumns[col][pos] = values[col];
+    }
+    if (mSize == mCapacity)
+    {
+      mHead = (mHead + 1) % mCapacity;
+    }
+    else
+    {
+      ++mSize;
+    }
+  }
+
+  void popFront()
+  {
+    assert(mSize > 0);
+    mHead = (mHead + 1) % mCapacity;
+    --mSize;
+  }
+
+  // drops all samples older than the given time
+  void expireBefore(const double time)
+  {
+    while (mSize > 0 && frontTime() < time)
+    {
+      popFront();
+    }
+  }
+
+  void clear()
+  {
+    mSize = 0;
+    mHead = 0;
+  }
+
+  std::size_t size() const { return mSize; }
+  std::size_t capacity() const { return mCapacity; }
+  bool empty() const { return mSize == 0; }
+
+  double time(const std::size_t idx) const
+  {
+    return mTime[physical(idx)];
+  }
+
+  double value(const std::size_t col, const std::size_t idx) const
+  {
+    return mColumns[col][physical(idx)];
+  }
+
+  double frontTime() const { return time(0); }
+  double backTime() const { return time(mSize - 1); }
+
+  // chronological index of the first sample at or after the given time
+  std::size_t lowerBound(const double time) const
+  {
+    std::size_t first = 0;
+    std::size_t count = mSize;
+    while (count > 0)
+    {
+      const std::size_t step = count / 2;
+      if (this->time(first + step) < time)
+      {
+        first += step + 1;
+        count -= step + 1;
+      }
+      else
+      {
+        count = step;
+      }
+    }
+    return first;
+  }
+
+  // copy samples [first, last) in chronological order, at most two memcpy runs
+  template<typename OutIt>
+  OutIt copyTimes(OutIt out, const std::size_t first = 0,
+    const std::size_t last = kEnd) const
+  {
+    return copyRange(mTime, out, first, last);
+  }
+
+  template<typename OutIt>
+  OutIt copyColumn(const std::size_t col, OutIt out, const std::size_t first = 0,
+    const std::size_t last = kEnd) const
+  {
+    return copyRange(mColumns[col], out, first, last);
+  }
+
+  // bytes held by the series, independent of the number of samples
+  std::size_t memoryUsage() const
+  {
+    return (Columns + 1) * mCapacity * sizeof(double);
+  }
+
+private:
+  std::size_t physical(const std::size_t idx) const
+  {
+    const std::size_t pos = mHead + idx;
+    return pos >= mCapacity ? pos - mCapacity : pos;
+  }
+
+  template<typename OutIt>
+  OutIt copyRange(const std::vector<double>& data, OutIt out,
+    const std::size_t first, const std::size_t last) const
+  {
+    const std::size_t end = (std::min)(last, mSize);
+    if (first >= end)
+    {
+      return out;
+    }
+    const std::size_t begin = physical(first);
+    const std::size_t count = end - first;
+    const std::size_t firstRun = (std::min)(count, mCapacity - begin);
+    out = std::copy(data.begin() + begin, data.begin() + begin + firstRun, out);
+    return std::copy(data.begin(), data.begin() + (count - firstRun), out);
+  }
+
+  std::vector<double> mTime;
+  std::array<std::vector<double>, Columns> mColumns;
+  std::size_t mCapacity = 0;
+  std::size_t mSize = 0;
+  std::size_t mHead = 0;
+};
+
+} // stats
+} // qst
+
+#endif /* timeseries_h */
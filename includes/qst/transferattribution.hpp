@@ -0,0 +1,448 @@
+/******************************************************************************
+ // QSyncthingTray
+ // Copyright (c) Matthias Frick, All rights reserved.
+ //
+ // This library is free software; you can redistribute it and/or
+ // modify it under the terms of the GNU Lesser General Public
+ // License as published by the Free Software Foundation; either
+ // version 3.0 of the License, or (at your option) any later version.
+ //
+ // This library is distributed in the hope that it will be useful,
+ // but WITHOUT ANY WARRANTY; without even the implied warranty of
+ // MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ // Lesser General Public License for more details.
+ //
+ // You should have received a copy of the GNU Lesser General Public
+ // License along with this library.
+ ******************************************************************************/
+
+#ifndef transferattribution_h
+#define transferattribution_h
+#pragma once
+
+#include <QHash>
+#include <QJsonObject>
+#include <QString>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <utility>
+#include <vector>
+
+namespace qst
+{
+namespace stats
+{
+
+//------------------------------------------------------------------------------------//
+
+// bytes/s attributed to a folder or device
+struct TransferRate
+{
+  QString key;
+  // what to show for the key, set by the user of the rates
+  QString label;
+  double inRate = 0;
+  double outRate = 0;
+
+  double total() const
+  {
+    return inRate + outRate;
+  }
+};
+
+// Syncthing reports remote progress in blocks, not bytes. The block size
+// of a file grows with its size, from 128 KiB up to 16 MiB, so that a file
+// has at most kMaxBlocksPerFile blocks.
+static const double kMinBlockBytes = 128 * 1024;
+static const double kMaxBlockBytes = 16 * 1024 * 1024;
+static const double kMaxBlocksPerFile = 2000;
+
+// the block size Syncthing uses for a file, exact when the number of blocks
+// is known
+inline double blockSize(const double fileSize, const double numBlocks = 0)
+{
+  double size = kMinBlockBytes;
+  while (size < kMaxBlockBytes &&
+    (numBlocks > 0 ? size * numBlocks < fileSize : fileSize >= kMaxBlocksPerFile * size))
+  {
+    size *= 2;
+  }
+  return size;
+}
+
+
+//------------------------------------------------------------------------------------//
+// Byte counters for at most 'capacity' keys. Every counter decays
+// exponentially with the time constant, so divided by it, it is the recent
+// rate. A new key takes the place of the counter with the lowest rate
+// once all are taken: memory stays bounded no matter how many folders or
+// devices there are, and the busy ones are never the ones dropped.
+//------------------------------------------------------------------------------------//
+
+class DecayingCounters
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit DecayingCounters(const std::size_t capacity,
+    const Clock::duration timeConstant = std::chrono::seconds(10)) :
+      mCapacity(capacity)
+    , mTimeConstant(std::chrono::duration_cast<std::chrono::duration<double>>(
+        timeConstant).count())
+  {
+    mEntries.reserve(capacity);
+  }
+
+  void add(const QString& key, const double inBytes, const double outBytes,
+    const Clock::time_point now)
+  {
+    auto it = mIndex.find(key);
+    if (it == mIndex.end())
+    {
+      it = mIndex.insert(key, insertionSlot(now));
+      mEntries[it.value()] = Entry{key, 0, 0, now};
+    }
+    auto& entry = mEntries[it.value()];
+    const auto factor = decay(entry, now);
+    entry.in = entry.in * factor + inBytes;
+    entry.out = entry.out * factor + outBytes;
+    entry.time = now;
+  }
+
+  // the busiest keys first, idle ones are left out
+  std::vector<TransferRate> top(const std::size_t count, const Clock::time_point now) const
+  {
+    std::vector<TransferRate> result;
+    for (const auto& entry : mEntries)
+    {
+      const auto factor = decay(entry, now) / mTimeConstant;
+      TransferRate rate;
+      rate.key = entry.key;
+      rate.inRate = entry.in * factor;
+      rate.outRate = entry.out * factor;
+      if (rate.total() >= 1)
+      {
+        result.push_back(rate);
+      }
+    }
+    const auto keep = (std::min)(count, result.size());
+    std::partial_sort(result.begin(), result.begin() + keep, result.end(),
+      [](const TransferRate& lhs, const TransferRate& rhs)
+      {
+        return lhs.total() > rhs.total();
+      });
+    result.resize(keep);
+    return result;
+  }
+
+  std::size_t size() const
+  {
+    return mEntries.size();
+  }
+
+  void clear()
+  {
+    mEntries.clear();
+    mIndex.clear();
+  }
+
+private:
+  struct Entry
+  {
+    QString key;
+    double in;
+    double out;
+    Clock::time_point time;
+  };
+
+  double decay(const Entry& entry, const Clock::time_point now) const
+  {
+    using namespace std::chrono;
+    const auto elapsed = duration_cast<duration<double>>(now - entry.time).count();
+    return elapsed > 0 ? std::exp(-elapsed / mTimeConstant) : 1.0;
+  }
+
+  std::size_t insertionSlot(const Clock::time_point now)
+  {
+    if (mEntries.size() < mCapacity)
+    {
+      mEntries.emplace_back();
+      return mEntries.size() - 1;
+    }
+    const auto quietest = std::min_element(mEntries.begin(), mEntries.end(),
+      [&](const Entry& lhs, const Entry& rhs)
+      {
+        return (lhs.in + lhs.out) * decay(lhs, now) < (rhs.in + rhs.out) * decay(rhs, now);
+      });
+    mIndex.remove(quietest->key);
+    return static_cast<std::size_t>(quietest - mEntries.begin());
+  }
+
+  std::size_t mCapacity;
+  double mTimeConstant;
+  std::vector<Entry> mEntries;
+  QHash<QString, std::size_t> mIndex;
+};
+
+
+//------------------------------------------------------------------------------------//
+// Attributes transferred bytes to folders and devices from the Syncthing
+// event stream. Downloads come from the bytesDone of DownloadProgress per
+// file, uploads from the blocks a remote device reports in
+// RemoteDownloadProgress. ItemStarted and ItemFinished bracket the files in
+// flight: a file seen first in the middle of a download only counts from
+// there on. DownloadProgress does not name the device it pulls from, so
+// devices are only attributed uploads. Uploads are held back until the
+// block size of the file is known, see unknownFiles and setFileSize.
+//------------------------------------------------------------------------------------//
+
+class TransferAttribution
+{
+public:
+  using Clock = std::chrono::steady_clock;
+  static const std::size_t kMaxTrackedKeys = 256;
+  static const int kMaxFilesInFlight = 4096;
+
+  TransferAttribution() :
+      mFolders(kMaxTrackedKeys)
+    , mDevices(kMaxTrackedKeys)
+  {
+  }
+
+  void processEvent(const QJsonObject& event, const Clock::time_point now)
+  {
+    mLastEventId = (std::max)(mLastEventId, event["id"].toInt());
+    const auto type = event["type"].toString();
+    const auto data = event["data"].toObject();
+    if (type == "ItemStarted")
+    {
+      if (mFiles.size() < kMaxFilesInFlight)
+      {
+        mFiles.insert(fileKey(data["folder"].toString(), data["item"].toString()),
+          FileProgress());
+      }
+    }
+    else if (type == "ItemFinished")
+    {
+      mFiles.remove(fileKey(data["folder"].toString(), data["item"].toString()));
+    }
+    else if (type == "DownloadProgress")
+    {
+      downloadProgress(data, now);
+    }
+    else if (type == "RemoteDownloadProgress")
+    {
+      remoteDownloadProgress(data, now);
+    }
+  }
+
+  // id to continue the event stream after
+  int lastEventId() const
+  {
+    return mLastEventId;
+  }
+
+  // A restarted Syncthing numbers its events from 1 again. The first batch
+  // after a restart replays what Syncthing still buffers, possibly minutes
+  // of transfers; it only sets the state of the files in flight and is not
+  // counted, see finishBatch.
+  void restartEventStream()
+  {
+    mLastEventId = 0;
+    mBaseline = true;
+    mFiles.clear();
+    mRemoteBlocks.clear();
+    mRemoteFiles = 0;
+  }
+
+  // called after each batch of events, transfers count from the next one on
+  void finishBatch()
+  {
+    mBaseline = false;
+  }
+
+  // files with uploads whose block size is not known yet, each handed out
+  // once; the pairs are folder and file
+  std::vector<std::pair<QString, QString>> unknownFiles(const std::size_t count)
+  {
+    std::vector<std::pair<QString, QString>> result;
+    for (auto it = mUnknownFiles.begin(); it != mUnknownFiles.end() &&
+      result.size() < count;)
+    {
+      result.push_back(*it);
+      it = mUnknownFiles.erase(it);
+    }
+    return result;
+  }
+
+  // size and number of blocks of a file, 0 if they could not be found out;
+  // the uploads held back for it are attributed now
+  void setFileSize(const QString& folder, const QString& file, const double size,
+    const double numBlocks, const Clock::time_point now)
+  {
+    const auto key = fileKey(folder, file);
+    const auto bytesPerBlock = size > 0 ? blockSize(size, numBlocks) : kMinBlockBytes;
+    if (mBlockSizes.size() >= kMaxFilesInFlight)
+    {
+      mBlockSizes.erase(mBlockSizes.begin());
+    }
+    mBlockSizes.insert(key, bytesPerBlock);
+    const auto pending = mPendingUploads.take(key);
+    for (auto device = pending.constBegin(); device != pending.constEnd(); ++device)
+    {
+      attributeUpload(folder, device.key(), device.value() * bytesPerBlock, now);
+    }
+  }
+
+  std::vector<TransferRate> topFolders(const std::size_t count,
+    const Clock::time_point now) const
+  {
+    return mFolders.top(count, now);
+  }
+
+  std::vector<TransferRate> topDevices(const std::size_t count,
+    const Clock::time_point now) const
+  {
+    return mDevices.top(count, now);
+  }
+
+private:
+  struct FileProgress
+  {
+    double bytesDone = 0;
+    // the DownloadProgress event that listed the file last, 0 for never
+    std::uint64_t generation = 0;
+  };
+
+  static QString fileKey(const QString& folder, const QString& file)
+  {
+    return folder + '\n' + file;
+  }
+
+  void downloadProgress(const QJsonObject& data, const Clock::time_point now)
+  {
+    // every event lists all files being pulled, the ones missing are done
+    ++mGeneration;
+    for (auto folder = data.constBegin(); folder != data.constEnd(); ++folder)
+    {
+      double bytes = 0;
+      const auto files = folder.value().toObject();
+      for (auto file = files.constBegin(); file != files.constEnd(); ++file)
+      {
+        const auto bytesDone = file.value().toObject()["bytesDone"].toDouble();
+        const auto key = fileKey(folder.key(), file.key());
+        auto progress = mFiles.find(key);
+        if (progress == mFiles.end())
+        {
+          if (mFiles.size() >= kMaxFilesInFlight)
+          {
+            continue;
+          }
+          progress = mFiles.insert(key, FileProgress());
+          progress->bytesDone = bytesDone;
+        }
+        bytes += (std::max)(0.0, bytesDone - progress->bytesDone);
+        progress->bytesDone = bytesDone;
+        progress->generation = mGeneration;
+      }
+      if (bytes > 0 && !mBaseline)
+      {
+        mFolders.add(folder.key(), bytes, 0, now);
+      }
+    }
+    for (auto it = mFiles.begin(); it != mFiles.end();)
+    {
+      if (it->generation != 0 && it->generation != mGeneration)
+      {
+        it = mFiles.erase(it);
+      }
+      else
+      {
+        ++it;
+      }
+    }
+  }
+
+  void remoteDownloadProgress(const QJsonObject& data, const Clock::time_point now)
+  {
+    // the state replaces the last one of this device and folder
+    const auto device = data["device"].toString();
+    const auto folder = data["folder"].toString();
+    const auto state = data["state"].toObject();
+    const auto key = fileKey(device, folder);
+    const auto previous = mRemoteBlocks.value(key);
+    const bool known = mRemoteBlocks.contains(key);
+    double bytes = 0;
+    QHash<QString, int> current;
+    for (auto file = state.constBegin(); file != state.constEnd(); ++file)
+    {
+      const auto done = file.value().toInt();
+      const auto blocks = known ? (std::max)(0, done - previous.value(file.key(), 0)) : 0;
+      current.insert(file.key(), done);
+      if (blocks == 0 || mBaseline)
+      {
+        continue;
+      }
+      const auto sizeKey = fileKey(folder, file.key());
+      const auto bytesPerBlock = mBlockSizes.constFind(sizeKey);
+      if (bytesPerBlock != mBlockSizes.constEnd())
+      {
+        bytes += blocks * bytesPerBlock.value();
+      }
+      else if (mPendingUploads.contains(sizeKey) ||
+        mPendingUploads.size() < kMaxFilesInFlight)
+      {
+        if (!mPendingUploads.contains(sizeKey))
+        {
+          mUnknownFiles.push_back(std::make_pair(folder, file.key()));
+        }
+        mPendingUploads[sizeKey][device] += blocks;
+      }
+    }
+    mRemoteFiles += current.size() - previous.size();
+    if (mRemoteFiles > kMaxFilesInFlight)
+    {
+      mRemoteFiles -= current.size();
+      mRemoteBlocks.remove(key);
+    }
+    else
+    {
+      mRemoteBlocks.insert(key, current);
+    }
+    if (bytes > 0)
+    {
+      attributeUpload(folder, device, bytes, now);
+    }
+  }
+
+  void attributeUpload(const QString& folder, const QString& device, const double bytes,
+    const Clock::time_point now)
+  {
+    mFolders.add(folder, 0, bytes, now);
+    mDevices.add(device, 0, bytes, now);
+  }
+
+  DecayingCounters mFolders;
+  DecayingCounters mDevices;
+  QHash<QString, FileProgress> mFiles;
+  // blocks per file for each device and folder pulling from us
+  QHash<QString, QHash<QString, int>> mRemoteBlocks;
+  int mRemoteFiles = 0;
+  // bytes per block of the files being uploaded, and the blocks uploaded
+  // per device of files whose block size is still being looked up
+  QHash<QString, double> mBlockSizes;
+  QHash<QString, QHash<QString, double>> mPendingUploads;
+  std::list<std::pair<QString, QString>> mUnknownFiles;
+  std::uint64_t mGeneration = 0;
+  int mLastEventId = 0;
+  bool mBaseline = false;
+};
+
+} // stats
+} // qst
+
+#endif /* transferattribution_h */
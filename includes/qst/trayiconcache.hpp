@@ -0,0 +1,254 @@
+/******************************************************************************
+ // QSyncthingTray
+ // Copyright (c) Matthias Frick, All rights reserved.
+ //
+ // This library is free software; you can redistribute it and/or
+ // modify it under the terms of the GNU Lesser General Public
+ // License as published by the Free Software Foundation; either
+ // version 3.0 of the License, or (at your option) any later version.
+ //
+ // This library is distributed in the hope that it will be useful,
+ // but WITHOUT ANY WARRANTY; without even the implied warranty of
+ // MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ // Lesser General Public License for more details.
+ //
+ // You should have received a copy of the GNU Lesser General Public
+ // License along with this library.
+ ******************************************************************************/
+
+#ifndef trayiconcache_h
+#define trayiconcache_h
+#pragma once
+
+#include <QGuiApplication>
+#include <QIcon>
+#include <QImage>
+#include <QImageReader>
+#include <QHash>
+#include <QMap>
+#include <QPainter>
+#include <QPair>
+#include <QPixmap>
+#include <QPolygonF>
+#include <QScreen>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <algorithm>
+
+namespace qst
+{
+namespace icons
+{
+
+//------------------------------------------------------------------------------------//
+// Tray and window icons, decoded once. Every file is rendered up front at
+// the sizes a tray asks for and at the pixel ratio of every screen, so
+// switching the state only hands out an icon that already exists: no file
+// is read, and no new icon engine is created for each change (which
+// QTBUG-23658 and QTBUG-16113 report as leaking). Animations are decoded
+// the same way into one icon per frame.
+// The progress icon is a static icon with a progress bar and traffic
+// arrows on top. Bar and arrows are drawn once per step and pixel size,
+// and each composed icon is kept as well; with 18 steps and 4 directions
+// there are at most 72 per static icon, so a change of the progress only
+// looks one up after the first round.
+//------------------------------------------------------------------------------------//
+
+class TrayIconCache
+{
+public:
+  // logical sizes used by the trays of macOS, Windows and the X11 desktops
+  static const QVector<int>& iconSizes()
+  {
+    static const QVector<int> sizes{16, 22, 24, 32, 48, 64};
+    return sizes;
+  }
+
+  enum class Direction { none, in, out, both };
+  static const int kProgressSteps = 16;
+
+  // the frames of an animation and the delay between them
+  struct Animation
+  {
+    QVector<QIcon> frames;
+    int frameDelayMs = 100;
+  };
+
+  TrayIconCache(const QStringList& paths, const QStringList& animationPaths)
+  {
+    QVector<qreal> ratios{1.0};
+    for (const auto screen : QGuiApplication::screens())
+    {
+      if (!ratios.contains(screen->devicePixelRatio()))
+      {
+        ratios.push_back(screen->devicePixelRatio());
+      }
+    }
+    for (const auto& path : paths)
+    {
+      if (!mIcons.contains(path))
+      {
+        mIcons.insert(path, render(QImage(path), ratios, &mImages[path]));
+      }
+    }
+    for (const auto& path : animationPaths)
+    {
+      QImageReader reader(path);
+      Animation animation;
+      QImage frame;
+      while (reader.read(&frame))
+      {
+        animation.frames.push_back(render(frame, ratios));
+        animation.frameDelayMs = (std::max)(animation.frameDelayMs, reader.nextImageDelay());
+      }
+      mAnimations.insert(path, animation);
+    }
+  }
+
+  // an empty icon for a path that was not given to the constructor
+  const QIcon& icon(const QString& path) const
+  {
+    const auto it = mIcons.find(path);
+    return it != mIcons.end() ? it.value() : mEmptyIcon;
+  }
+
+  // no frames for a path that was not given to the constructor
+  const Animation& animation(const QString& path) const
+  {
+    const auto it = mAnimations.find(path);
+    return it != mAnimations.end() ? it.value() : mEmptyAnimation;
+  }
+
+  // the static icon of 'path' with step of kProgressSteps shown as done,
+  // without a bar for a negative step
+  const QIcon& progressIcon(const QString& path, const int step,
+    const Direction direction)
+  {
+    const auto clampedStep = step < 0 ? -1 : step > kProgressSteps ? kProgressSteps : step;
+    const ProgressKey key(path, LayerKey(clampedStep, static_cast<int>(direction)));
+    auto it = mProgressIcons.find(key);
+    if (it != mProgressIcons.end())
+    {
+      return it.value();
+    }
+    // only paths given to the constructor are kept, others have no images
+    if (!mImages.contains(path))
+    {
+      return mEmptyIcon;
+    }
+    QIcon progressIcon;
+    for (const auto& base : mImages.value(path))
+    {
+      const auto pixels = base.width();
+      auto image = base.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+      image.setDevicePixelRatio(1);
+      QPainter painter(&image);
+      if (clampedStep >= 0)
+      {
+        const auto& bar = progressBar(pixels, clampedStep);
+        painter.drawImage(0, image.height() - bar.height(), bar);
+      }
+      painter.drawImage(0, 0, arrows(pixels, direction));
+      painter.end();
+      image.setDevicePixelRatio(base.devicePixelRatio());
+      progressIcon.addPixmap(QPixmap::fromImage(image));
+    }
+    return mProgressIcons.insert(key, progressIcon).value();
+  }
+
+private:
+  using LayerKey = QPair<int, int>;
+  // path, and step and direction
+  using ProgressKey = QPair<QString, LayerKey>;
+
+  // a strip as wide as the icon, filled up to the step
+  const QImage& progressBar(const int pixels, const int step)
+  {
+    const LayerKey key(pixels, step);
+    auto it = mProgressBars.find(key);
+    if (it == mProgressBars.end())
+    {
+      QImage bar(pixels, (std::max)(2, pixels / 8), QImage::Format_ARGB32_Premultiplied);
+      bar.fill(QColor(0, 0, 0, 160));
+      QPainter painter(&bar);
+      painter.fillRect(0, 0, pixels * step / kProgressSteps, bar.height(),
+        QColor(0, 200, 0));
+      painter.end();
+      it = mProgressBars.insert(key, bar);
+    }
+    return it.value();
+  }
+
+  // outgoing traffic as an arrow up at the left, incoming as one down at
+  // the right, in the colours of the traffic plot
+  const QImage& arrows(const int pixels, const Direction direction)
+  {
+    const LayerKey key(pixels, static_cast<int>(direction));
+    auto it = mArrows.find(key);
+    if (it == mArrows.end())
+    {
+      QImage image(pixels, pixels, QImage::Format_ARGB32_Premultiplied);
+      image.fill(Qt::transparent);
+      QPainter painter(&image);
+      painter.setRenderHint(QPainter::Antialiasing);
+      painter.setPen(Qt::NoPen);
+      const qreal size = (std::max)(3, pixels * 3 / 8);
+      if (direction == Direction::out || direction == Direction::both)
+      {
+        painter.setBrush(QColor(255, 0, 0));
+        painter.drawPolygon(QPolygonF(QVector<QPointF>{
+          QPointF(size / 2, 0), QPointF(size, size), QPointF(0, size)}));
+      }
+      if (direction == Direction::in || direction == Direction::both)
+      {
+        painter.setBrush(QColor(0, 255, 255));
+        painter.drawPolygon(QPolygonF(QVector<QPointF>{
+          QPointF(pixels - size, 0), QPointF(pixels, 0), QPointF(pixels - size / 2, size)}));
+      }
+      painter.end();
+      it = mArrows.insert(key, image);
+    }
+    return it.value();
+  }
+
+  static QIcon render(const QImage& image, const QVector<qreal>& ratios,
+    QVector<QImage>* scaledImages = nullptr)
+  {
+    QIcon icon;
+    if (image.isNull())
+    {
+      return icon;
+    }
+    for (const auto ratio : ratios)
+    {
+      for (const auto size : iconSizes())
+      {
+        const auto pixels = (std::min)(image.width(), qRound(size * ratio));
+        auto scaled = image.scaled(pixels, pixels, Qt::KeepAspectRatio,
+          Qt::SmoothTransformation);
+        scaled.setDevicePixelRatio(ratio);
+        icon.addPixmap(QPixmap::fromImage(scaled));
+        if (scaledImages != nullptr)
+        {
+          scaledImages->push_back(scaled);
+        }
+      }
+    }
+    return icon;
+  }
+
+  QMap<QString, QIcon> mIcons;
+  QMap<QString, QVector<QImage>> mImages;
+  QHash<LayerKey, QImage> mProgressBars;
+  QHash<LayerKey, QImage> mArrows;
+  QHash<ProgressKey, QIcon> mProgressIcons;
+  QMap<QString, Animation> mAnimations;
+  QIcon mEmptyIcon;
+  Animation mEmptyAnimation;
+};
+
+} // icons
+} // qst
+
+#endif /* trayiconcache_h */
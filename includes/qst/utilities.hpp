@@ -189,21 +189,6 @@ inline auto checkIfFileExists(QString path) -> bool
 
 //------------------------------------------------------------------------------------//
 
-template<size_t N, typename Container>
-  auto find_max_tuple_value(Container& c) ->
-    typename std::tuple_element<N, typename Container::value_type>::type
-{
-  using ContainerValueType = typename Container::value_type;
-  const auto elem = std::max_element(c.begin(), c.end(),
-    [](const ContainerValueType& lhs, const ContainerValueType& rhs)
-    {
-      return(std::get<N>(lhs) < std::get<N>(rhs));
-    });
-  return std::move(std::get<N>(*elem));
-}
-
-
-//------------------------------------------------------------------------------------//
 // retrieve index of type in tuple
 template <class T, class Tuple>
 struct Index;
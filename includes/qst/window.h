@@ -24,8 +24,10 @@
 #include "startuptab.hpp"
 #include "platforms.hpp"
 #include <qst/appsettings.hpp>
+#include <qst/keyedmenu.hpp>
 #include <qst/processcontroller.h>
 #include <qst/statswidget.h>
+#include <qst/trayiconcache.hpp>
 #include <qst/updatenotifier.h>
 #include <QDoubleSpinBox>
 #include <QSystemTrayIcon>
@@ -35,7 +37,8 @@
 #include <QProcess>
 #include <QFileDialog>
 #include <QTabWidget>
-#include <QMovie>
+#include <QElapsedTimer>
+#include <QTimer>
 #include <memory>
 
 
@@ -83,8 +86,8 @@ private slots:
     void notificationsIconBoxChanged(int state);
     void webViewZoomFactorChanged(double value);
     void showAboutPage();
-    void folderClicked();
-    void syncedFileClicked();
+    void folderClicked(QAction* action);
+    void syncedFileClicked(QAction* action);
     void onUpdateIcon();
     void pauseSyncthingClicked(int state);
     void quit();
@@ -101,9 +104,15 @@ private:
       QSystemTrayIcon::MessageIcon icon = QSystemTrayIcon::Information);
     void createFoldersMenu();
     void createLastSyncedMenu();
+    static QString syncedFileKey(const DateFolderFile& file);
+    void updateTopFoldersMenu(const std::vector<qst::stats::TransferRate>& folders);
+    auto labeledFolderTraffic() -> std::vector<qst::stats::TransferRate>;
     void createDefaultSettings();
     void validateSSLSupport();
     void onStartAnimation(bool animate);
+    auto currentAnimation() -> const qst::icons::TrayIconCache::Animation&;
+    bool updateProgressOverlay(const double completion, const double inTraffic,
+      const double outTraffic);
 
     QTabWidget *mpSettingsTabsWidget;
     QGroupBox *mpSettingsGroupBox;
@@ -147,10 +156,12 @@ private:
 
     qst::stats::StatsWidget *mpStatsWidget;
 
-    QList<QAction*> mCurrentFoldersActions;
     QMenu *mpFolderMenu = nullptr;
-    QList<QAction*> mCurrentSyncedFilesActions;
+    std::unique_ptr<qst::menu::KeyedMenu<FolderNameFullPath>> mpFolderMenuModel;
     QMenu *mpLastSyncedMenu = nullptr;
+    std::unique_ptr<qst::menu::KeyedMenu<DateFolderFile>> mpLastSyncedMenuModel;
+    QList<QAction*> mTopFoldersActions;
+    QMenu *mpTopFoldersMenu = nullptr;
 
     std::list<FolderNameFullPath> mCurrentFoldersLocations;
     LastSyncedFileList mLastSyncedFiles;
@@ -168,7 +179,13 @@ private:
     std::unique_ptr<qst::monitor::ProcessMonitor> mpProcessMonitor;
     std::unique_ptr<qst::settings::StartupTab> mpStartupTab;
   
-    std::unique_ptr<QMovie> mpAnimatedIconMovie;
+    qst::icons::TrayIconCache mTrayIcons;
+    QTimer mAnimationTimer;
+    QElapsedTimer mLastNetworkActivity;
+    int mAnimationFrame = -1;
+    int mProgressStep = -1;
+    qst::icons::TrayIconCache::Direction mTrafficDirection =
+      qst::icons::TrayIconCache::Direction::none;
 
     bool mIconMonochrome;
     bool mNotificationsEnabled;
@@ -0,0 +1,264 @@
+/******************************************************************************
+ // QSyncthingTray
+ // Copyright (c) Matthias Frick, All rights reserved.
+ //
+ // This library is free software; you can redistribute it and/or
+ // modify it under the terms of the GNU Lesser General Public
+ // License as published by the Free Software Foundation; either
+ // version 3.0 of the License, or (at your option) any later version.
+ //
+ // This library is distributed in the hope that it will be useful,
+ // but WITHOUT ANY WARRANTY; without even the implied warranty of
+ // MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ // Lesser General Public License for more details.
+ //
+ // You should have received a copy of the GNU Lesser General Public
+ // License along with this library.
+ ******************************************************************************/
+
+
+//------------------------------------------------------------------------------------//
+// Update cost of the folders menu with many folders. Times the rebuild the
+// tray used to do on every change, deleting and recreating all actions,
+// against KeyedMenu for an unchanged list, one folder renamed, added or
+// removed, and the whole list reversed, plus the lazy texts set before the
+// menu is shown. Results are written as JSON to stdout or to the file
+// given as argument.
+//
+//   QT_QPA_PLATFORM=offscreen ./qst_menubenchmark [--quick] [results.json]
+//------------------------------------------------------------------------------------//
+
+#include <qst/keyedmenu.hpp>
+#include <qst/utilities.hpp>
+#include <QApplication>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace
+{
+  using Folder = std::pair<QString, QString>;
+  using Folders = std::list<Folder>;
+  using FolderMenu = qst::menu::KeyedMenu<Folder>;
+
+  struct Timing
+  {
+    double minMs;
+    double medianMs;
+  };
+
+  // setup runs before every timed call and is not measured
+  template<typename Setup, typename Func>
+  Timing measure(const int iterations, Setup&& setup, Func&& func)
+  {
+    std::vector<double> samples;
+    samples.reserve(iterations);
+    QElapsedTimer timer;
+    for (int run = 0; run < iterations; ++run)
+    {
+      setup();
+      timer.start();
+      func();
+      samples.push_back(timer.nsecsElapsed() / 1e6);
+      // actions are deleted later, not in the next run
+      QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+    }
+    std::sort(samples.begin(), samples.end());
+    return {samples.front(), samples[samples.size() / 2]};
+  }
+
+  QJsonObject toJson(const QString& name, const int numFolders, const Timing& timing)
+  {
+    QJsonObject result;
+    result["case"] = name;
+    result["folders"] = numFolders;
+    result["min_ms"] = timing.minMs;
+    result["median_ms"] = timing.medianMs;
+    return result;
+  }
+
+  Folders syntheticFolders(const int numFolders)
+  {
+    Folders folders;
+    for (int idx = 0; idx < numFolders; ++idx)
+    {
+      const auto id = QString("fold-%1").arg(idx, 5, 10, QChar('0'));
+      folders.emplace_back(id, "/home/user/Sync/projects/" + id + "/");
+    }
+    return folders;
+  }
+
+  FolderMenu* folderMenu(QMenu* menu)
+  {
+    return new FolderMenu(menu,
+      [](const Folder& folder)
+      {
+        return folder.first;
+      },
+      [](QAction* action, const Folder& folder)
+      {
+        action->setText(qst::utilities::getFullCleanFileName(folder.second));
+      });
+  }
+
+  // what createFoldersMenu did before the keyed menu, the actions were
+  // owned by the window
+  void rebuild(QMenu& menu, QObject& owner, QList<QAction*>& actions,
+    const Folders& folders)
+  {
+    menu.clear();
+    for (auto action : actions)
+    {
+      action->deleteLater();
+    }
+    actions.clear();
+    for (const auto& folder : folders)
+    {
+      actions.push_back(new QAction(
+        qst::utilities::getFullCleanFileName(folder.second), &owner));
+    }
+    menu.addActions(actions);
+  }
+
+  QJsonArray benchmarkFolders(const int numFolders, const int iterations)
+  {
+    QJsonArray results;
+    const auto folders = syntheticFolders(numFolders);
+    auto renamed = folders;
+    std::next(renamed.begin(), numFolders / 2)->second += "renamed/";
+    auto added = folders;
+    added.insert(std::next(added.begin(), numFolders / 2),
+      Folder("added", "/home/user/Sync/added/"));
+    auto removed = folders;
+    removed.erase(std::next(removed.begin(), numFolders / 2));
+    auto reversed = folders;
+    reversed.reverse();
+
+    {
+      QMenu menu;
+      QObject owner;
+      QList<QAction*> actions;
+      rebuild(menu, owner, actions, folders);
+      results.append(toJson("rebuild", numFolders, measure(iterations, [] {},
+        [&]
+      {
+        rebuild(menu, owner, actions, renamed);
+      })));
+    }
+
+    QMenu menu;
+    std::unique_ptr<FolderMenu> model;
+    const auto fresh = [&]
+    {
+      model.reset();
+      menu.clear();
+      model.reset(folderMenu(&menu));
+      model->update(folders);
+      model->applyPending();
+    };
+    results.append(toJson("keyed_initial", numFolders, measure(iterations,
+      [&]
+    {
+      model.reset();
+      menu.clear();
+      model.reset(folderMenu(&menu));
+    },
+      [&]
+    {
+      model->update(folders);
+      model->applyPending();
+    })));
+    const std::vector<std::pair<QString, const Folders*>> cases{
+      {"keyed_unchanged", &folders},
+      {"keyed_renamed", &renamed},
+      {"keyed_added", &added},
+      {"keyed_removed", &removed},
+      {"keyed_reversed", &reversed}};
+    for (const auto& change : cases)
+    {
+      const auto& target = *change.second;
+      results.append(toJson(change.first, numFolders, measure(iterations, fresh,
+        [&]
+      {
+        model->update(target);
+      })));
+      results.append(toJson(change.first + "_shown", numFolders,
+        measure(iterations, fresh, [&]
+      {
+        model->update(target);
+        model->applyPending();
+      })));
+    }
+    // the check the tray does on every poll before touching the menu
+    const auto polled = folders;
+    results.append(toJson("compare_unchanged", numFolders, measure(iterations, [] {},
+      [&]
+    {
+      volatile bool changed = folders != polled;
+      (void)changed;
+    })));
+    return results;
+  }
+} // anon
+
+//------------------------------------------------------------------------------------//
+
+int main(int argc, char *argv[])
+{
+  if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+  {
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  }
+  QApplication app(argc, argv);
+  auto args = app.arguments();
+  args.removeFirst();
+  const bool quick = args.removeAll("--quick") > 0;
+
+  const std::vector<int> sizes = quick ?
+    std::vector<int>{100, 1000} : std::vector<int>{100, 1000, 5000};
+  QJsonArray results;
+  for (const auto numFolders : sizes)
+  {
+    for (const auto result : benchmarkFolders(numFolders, quick ? 5 : 20))
+    {
+      results.append(result);
+    }
+    std::cerr << "." << std::flush;
+  }
+  std::cerr << std::endl;
+
+  QJsonObject report;
+  report["benchmark"] = QString("menu");
+  report["qt_version"] = QString(qVersion());
+  report["platform"] = QApplication::platformName();
+  report["results"] = results;
+  const auto json = QJsonDocument(report).toJson();
+
+  if (args.isEmpty())
+  {
+    std::cout << json.toStdString();
+    return 0;
+  }
+  QFile file(args.first());
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+  {
+    std::cerr << "Unable to write benchmark results: "
+      << file.errorString().toStdString() << std::endl;
+    return 1;
+  }
+  file.write(json);
+  return 0;
+}
@@ -0,0 +1,801 @@
+/******************************************************************************
+ // QSyncthingTray
+ // Copyright (c) Matthias Frick, All rights reserved.
+ //
+ // This library is free software; you can redistribute it and/or
+ // modify it under the terms of the GNU Lesser General Public
+ // License as published by the Free Software Foundation; either
+ // version 3.0 of the License, or (at your option) any later version.
+ //
+ // This library is distributed in the hope that it will be useful,
+ // but WITHOUT ANY WARRANTY; without even the implied warranty of
+ // MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ // Lesser General Public License for more details.
+ //
+ // You should have received a copy of the GNU Lesser General Public
+ // License along with this library.
+ ******************************************************************************/
+
+
+//------------------------------------------------------------------------------------//
+// Offscreen render benchmark for the stats plots.
+// Builds the traffic plot exactly like StatsWidget does, fills it with
+// synthetic samples and times replot() and toPixmap() for a matrix of
+// history lengths, widget sizes, antialiasing and adaptive sampling, plus
+// the ingest into the history with and without frequent gaps, the value
+// range kernel, the data container in its growing and its bounded
+// streaming mode, the replot with and without the vectorized min/max
+// kernels, LTTB decimation against adaptive sampling and the spikes
+// it keeps over the raw samples and over an aggregate tier, appending
+// live samples to the graphs against resetting them, scrolled strip chart
+// frames against fully drawn ones per live tick, the GUI thread time per
+// update once the graphs are drawn by PlotRasterizer and the latency from a
+// pan or zoom over a week of history to its frame.
+// Results are written as JSON to stdout or to the file given as argument.
+//
+//   QT_QPA_PLATFORM=offscreen ./qst_statsbenchmark [--quick] [results.json]
+//------------------------------------------------------------------------------------//
+
+#include <qst/lttb.hpp>
+#include <qst/plotrasterizer.h>
+#include <qst/statshistory.hpp>
+#include <qst/statsplot.hpp>
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace
+{
+  using namespace qst::stats;
+
+  struct Timing
+  {
+    double minMs;
+    double medianMs;
+  };
+
+  template<typename Func>
+  Timing measure(const int iterations, Func&& func)
+  {
+    std::vector<double> samples;
+    samples.reserve(iterations);
+    QElapsedTimer timer;
+    for (int run = 0; run < iterations; ++run)
+    {
+      timer.start();
+      func();
+      samples.push_back(timer.nsecsElapsed() / 1e6);
+    }
+    std::sort(samples.begin(), samples.end());
+    return {samples.front(), samples[samples.size() / 2]};
+  }
+
+  QJsonObject toJson(const Timing& timing)
+  {
+    QJsonObject result;
+    result["min_ms"] = timing.minMs;
+    result["median_ms"] = timing.medianMs;
+    return result;
+  }
+
+  // bursty traffic: mostly idle, now and then a transfer at a few MB/s
+  void syntheticTraffic(const int numPoints, QVector<double>& time,
+    QVector<double>& in, QVector<double>& out)
+  {
+    std::mt19937 rng(42);
+    std::exponential_distribution<double> burst(1 / 500.0);
+    std::uniform_real_distribution<double> noise(0, 2);
+    const double start = 1.5e9;
+    time.resize(numPoints);
+    in.resize(numPoints);
+    out.resize(numPoints);
+    for (int idx = 0; idx < numPoints; ++idx)
+    {
+      const bool active = (idx / 600) % 3 == 0;
+      time[idx] = start + idx;
+      in[idx] = noise(rng) + (active ? burst(rng) : 0);
+      out[idx] = noise(rng) + (active ? burst(rng) / 4 : 0);
+    }
+  }
+
+  QJsonObject benchmarkRender(const int numPoints, const QSize& size,
+    const bool antialiasing, const bool adaptiveSampling, const int iterations)
+  {
+    QCustomPlot plot;
+    QSharedPointer<QCPAxisTickerDateTime> ticker(new QCPAxisTickerDateTime);
+    ticker->setDateTimeFormat("hh:mm");
+    addTrafficGraphs(&plot);
+    configureStatsPlot(&plot, "Traffic", ticker, plot.font());
+    if (antialiasing)
+    {
+      plot.setAntialiasedElements(QCP::aeAll);
+    }
+    else
+    {
+      plot.setNotAntialiasedElements(QCP::aeAll);
+    }
+
+    QVector<double> time, in, out;
+    syntheticTraffic(numPoints, time, in, out);
+    plot.graph(0)->setData(time, out, true);
+    plot.graph(1)->setData(time, in, true);
+    for (int graph = 0; graph < plot.graphCount(); ++graph)
+    {
+      plot.graph(graph)->setAdaptiveSampling(adaptiveSampling);
+    }
+    plot.xAxis->setRange(time.first(), time.last());
+    plot.yAxis->rescale();
+    plot.resize(size);
+    plot.show();
+    QApplication::processEvents();
+    // the first replot sets up the paint buffers
+    plot.replot();
+
+    QJsonObject result;
+    result["scenario"] = QString("render");
+    result["points"] = numPoints;
+    result["width"] = size.width();
+    result["height"] = size.height();
+    result["antialiasing"] = antialiasing;
+    result["adaptive_sampling"] = adaptiveSampling;
+    result["replot"] = toJson(measure(iterations, [&plot]
+    {
+      plot.replot(QCustomPlot::rpImmediateRefresh);
+    }));
+    result["to_pixmap"] = toJson(measure(iterations, [&plot, &size]
+    {
+      plot.toPixmap(size.width(), size.height());
+    }));
+    return result;
+  }
+
+  // the replot of the render scenario with adaptive sampling, once with the
+  // scalar min/max loop of QCPGraph and once with its vectorized kernels,
+  // against the 3x the kernels were meant to bring
+  QJsonObject benchmarkRenderSimd(const int numPoints, const QSize& size,
+    const int iterations)
+  {
+    const bool simd = qcpSimdEnabled();
+    qcpSetSimdEnabled(false);
+    const auto scalar = benchmarkRender(numPoints, size, false, true, iterations);
+    qcpSetSimdEnabled(true);
+    const auto vectorized = benchmarkRender(numPoints, size, false, true, iterations);
+    const bool available = qcpSimdEnabled();
+    qcpSetSimdEnabled(simd);
+    const auto scalarMs = scalar["replot"].toObject()["median_ms"].toDouble();
+    const auto vectorizedMs = vectorized["replot"].toObject()["median_ms"].toDouble();
+
+    QJsonObject result;
+    result["scenario"] = QString("render_simd");
+    result["points"] = numPoints;
+    result["width"] = size.width();
+    result["height"] = size.height();
+    result["simd_available"] = available;
+    result["scalar"] = scalar["replot"];
+    result["simd"] = vectorized["replot"];
+    result["speedup"] = vectorizedMs > 0 ? scalarMs / vectorizedMs : 0.0;
+    result["target_speedup"] = 3.0;
+    return result;
+  }
+
+  // cost of getting samples into the history, gap detection included
+  QJsonObject benchmarkIngest(const int numPoints, const int iterations)
+  {
+    QVector<double> time, in, out;
+    syntheticTraffic(numPoints, time, in, out);
+    QJsonObject result;
+    result["scenario"] = QString("ingest");
+    result["points"] = numPoints;
+    result["push"] = toJson(measure(iterations, [&]
+    {
+      StatsHistory<2> history;
+      for (int idx = 0; idx < numPoints; ++idx)
+      {
+        history.push(time[idx], {{in[idx], out[idx]}});
+      }
+    }));
+    return result;
+  }
+
+  // 24 h of a laptop that suspends often: 1 Hz samples with a gap of a
+  // minute every ten, each gap zero-filled on both sides by the history
+  QJsonObject benchmarkIngestGaps(const int iterations)
+  {
+    const int day = 24 * 3600;
+    const int awake = 600;
+    const int asleep = 60;
+    QVector<double> time, in, out;
+    syntheticTraffic(day, time, in, out);
+    int numPoints = 0;
+    for (int second = 0; second < day; ++second)
+    {
+      if (second % (awake + asleep) < awake)
+      {
+        time[numPoints] = time.first() + second;
+        ++numPoints;
+      }
+    }
+    QJsonObject result;
+    result["scenario"] = QString("ingest_gaps");
+    result["points"] = numPoints;
+    result["gaps"] = day / (awake + asleep);
+    std::size_t stored = 0;
+    result["push"] = toJson(measure(iterations, [&]
+    {
+      StatsHistory<2> history;
+      for (int idx = 0; idx < numPoints; ++idx)
+      {
+        history.push(time[idx], {{in[idx], out[idx]}});
+      }
+      stored = history.memoryUsage();
+    }));
+    result["history_bytes"] = static_cast<double>(stored);
+    return result;
+  }
+
+  // one live update per iteration with the whole history visible: the
+  // new sample is appended and the oldest one cut off, or, as before
+  // incremental feeding, the graphs are reset to the whole window; then the
+  // plot is replotted
+  QJsonObject benchmarkFeed(const int numPoints, const QSize& size,
+    const bool incremental, const int ticks)
+  {
+    QCustomPlot plot;
+    QSharedPointer<QCPAxisTickerDateTime> ticker(new QCPAxisTickerDateTime);
+    ticker->setDateTimeFormat("hh:mm");
+    addTrafficGraphs(&plot);
+    configureStatsPlot(&plot, "Traffic", ticker, plot.font());
+    plot.resize(size);
+    plot.show();
+    QApplication::processEvents();
+
+    QVector<double> time, in, out;
+    syntheticTraffic(numPoints + ticks, time, in, out);
+    plot.graph(0)->setData(time.mid(0, numPoints), out.mid(0, numPoints), true);
+    plot.graph(1)->setData(time.mid(0, numPoints), in.mid(0, numPoints), true);
+    plot.yAxis->setRange(0, (std::max)(
+      *std::max_element(in.begin(), in.end()), *std::max_element(out.begin(), out.end())));
+    plot.xAxis->setRange(time[0], time[numPoints - 1]);
+    plot.replot();
+
+    int tick = numPoints;
+    const auto timing = measure(ticks, [&]
+    {
+      const int first = tick - numPoints + 1;
+      if (incremental)
+      {
+        plot.graph(0)->addData(time[tick], out[tick]);
+        plot.graph(1)->addData(time[tick], in[tick]);
+        plot.graph(0)->data()->removeBefore(time[first]);
+        plot.graph(1)->data()->removeBefore(time[first]);
+      }
+      else
+      {
+        plot.graph(0)->setData(time.mid(first, numPoints), out.mid(first, numPoints), true);
+        plot.graph(1)->setData(time.mid(first, numPoints), in.mid(first, numPoints), true);
+      }
+      plot.xAxis->setRange(time[first], time[tick]);
+      plot.replot(QCustomPlot::rpImmediateRefresh);
+      ++tick;
+    });
+
+    QJsonObject result;
+    result["scenario"] = QString("feed");
+    result["points"] = numPoints;
+    result["width"] = size.width();
+    result["height"] = size.height();
+    result["incremental"] = incremental;
+    result["ticks"] = ticks;
+    result["tick"] = toJson(timing);
+    return result;
+  }
+
+  // QCPDataContainer::valueRange, which runs the vectorized min/max kernel
+  // of QCPGraph, against the plain loop it replaced; with QCP_DISABLE_SIMD
+  // both run the scalar loop
+  QJsonObject benchmarkValueRange(const int numPoints, const int iterations)
+  {
+    QVector<double> time, in, out;
+    syntheticTraffic(numPoints, time, in, out);
+    QVector<QCPGraphData> data(numPoints);
+    for (int idx = 0; idx < numPoints; ++idx)
+    {
+      data[idx] = QCPGraphData(time[idx], in[idx]);
+    }
+    QCPGraphDataContainer container;
+    container.set(data, true);
+    volatile double sink = 0;
+    const auto kernel = measure(iterations, [&]
+    {
+      bool found = false;
+      sink = container.valueRange(found).size();
+    });
+    const auto scalar = measure(iterations, [&]
+    {
+      double min = container.constBegin()->value;
+      double max = min;
+      for (auto it = container.constBegin(); it != container.constEnd(); ++it)
+      {
+        if (it->value < min)
+        {
+          min = it->value;
+        }
+        if (it->value > max)
+        {
+          max = it->value;
+        }
+      }
+      sink = max - min;
+    });
+    (void)sink;
+
+    QJsonObject result;
+    result["scenario"] = QString("value_range");
+    result["points"] = numPoints;
+    result["kernel"] = toJson(kernel);
+    result["scalar_loop"] = toJson(scalar);
+    result["speedup"] = kernel.medianMs > 0 ? scalar.medianMs / kernel.medianMs : 0.0;
+    return result;
+  }
+
+  // exposes the storage address so reallocations can be counted
+  class ProbedContainer : public QCPGraphDataContainer
+  {
+  public:
+    const void* storage() const { return mData.constData(); }
+  };
+
+  // steady state streaming as done by the stats plots: append one sample,
+  // expire the oldest, over and over
+  QJsonObject benchmarkStreaming(const int window, const bool bounded, const int steps)
+  {
+    ProbedContainer container;
+    if (bounded)
+    {
+      container.setCapacity(window);
+    }
+    double key = 0;
+    for (; key < window; ++key)
+    {
+      container.add(QCPGraphData(key, 1));
+    }
+    int reallocations = 0;
+    const auto timing = measure(1, [&]
+    {
+      for (int step = 0; step < steps; ++step, ++key)
+      {
+        const void* before = container.storage();
+        container.add(QCPGraphData(key, 1));
+        container.removeBefore(key - window);
+        reallocations += container.storage() != before ? 1 : 0;
+      }
+    });
+    QJsonObject result;
+    result["scenario"] = QString("streaming");
+    result["points"] = window;
+    result["bounded"] = bounded;
+    result["steps"] = steps;
+    result["reallocations"] = reallocations;
+    result["total"] = toJson(timing);
+    return result;
+  }
+
+  // how many of the 100 largest samples from 'first' on are found unchanged
+  // in the decimated values
+  int spikesKept(const QVector<double>& values, const int first, QVector<double> kept)
+  {
+    QVector<double> largest = values.mid(first);
+    const auto numLargest = (std::min)(100, largest.size());
+    std::partial_sort(largest.begin(), largest.begin() + numLargest, largest.end(),
+      std::greater<double>());
+    std::sort(kept.begin(), kept.end());
+    int result = 0;
+    for (int idx = 0; idx < numLargest; ++idx)
+    {
+      result += std::binary_search(kept.begin(), kept.end(), largest[idx]) ? 1 : 0;
+    }
+    return result;
+  }
+
+  // LTTB down to two points per pixel followed by a plain replot, against
+  // handing all points to QCustomPlot's adaptive sampling
+  QJsonObject benchmarkDecimation(const int numPoints, const QSize& size,
+    const int iterations)
+  {
+    QVector<double> time, in, out;
+    syntheticTraffic(numPoints, time, in, out);
+    const int target = 2 * size.width();
+    QVector<double> decimatedTime, decimatedValue;
+
+    QCustomPlot plot;
+    plot.addGraph();
+    plot.resize(size);
+    plot.xAxis->setRange(time.first(), time.last());
+    plot.yAxis->setRange(0, *std::max_element(in.begin(), in.end()));
+    plot.show();
+    QApplication::processEvents();
+
+    plot.graph(0)->setAdaptiveSampling(true);
+    const auto adaptive = measure(iterations, [&]
+    {
+      plot.graph(0)->setData(time, in, true);
+      plot.replot(QCustomPlot::rpImmediateRefresh);
+    });
+    plot.graph(0)->setAdaptiveSampling(false);
+    const auto lttb = measure(iterations, [&]
+    {
+      LttbDecimator decimator((time.last() - time.first()) / target);
+      decimatedTime.clear();
+      decimatedValue.clear();
+      for (int idx = 0; idx < numPoints; ++idx)
+      {
+        decimator.push(time[idx], in[idx], decimatedTime, decimatedValue);
+      }
+      decimator.pending(decimatedTime, decimatedValue);
+      plot.graph(0)->setData(decimatedTime, decimatedValue, true);
+      plot.replot(QCustomPlot::rpImmediateRefresh);
+    });
+
+    // the same over the tier the live view picks for the whole span, with
+    // LTTB over the bucket averages against over the bucket maxima
+    StatsHistory<2> history;
+    for (int idx = 0; idx < numPoints; ++idx)
+    {
+      history.push(time[idx], {{in[idx], out[idx]}});
+    }
+    // kDecimationOversampling of StatsWidget
+    const auto slice = history.slice(time.first(), time.last(), target * 8);
+    const auto decimateTier = [&](const Statistic stat)
+    {
+      const auto count = static_cast<int>(slice.last - slice.first);
+      QVector<double> tierTime(count), tierValue(count), plotTime, plotValue;
+      history.copyTimes(slice.tier, tierTime.begin(), slice.first, slice.last);
+      history.copyColumn(slice.tier, 0, stat, tierValue.begin(), slice.first, slice.last);
+      LttbDecimator decimator((time.last() - time.first()) / target);
+      for (int idx = 0; idx < count; ++idx)
+      {
+        decimator.push(tierTime[idx], tierValue[idx], plotTime, plotValue);
+      }
+      decimator.pending(plotTime, plotValue);
+      return plotValue;
+    };
+    // only the samples the tier still covers can be kept
+    const auto tierStart = history.time(slice.tier, slice.first) -
+      history.resolution(slice.tier);
+    const auto tierFirst = static_cast<int>(
+      std::lower_bound(time.begin(), time.end(), tierStart) - time.begin());
+
+    QJsonObject result;
+    result["scenario"] = QString("decimation");
+    result["points"] = numPoints;
+    result["width"] = size.width();
+    result["height"] = size.height();
+    result["adaptive_sampling"] = toJson(adaptive);
+    result["lttb"] = toJson(lttb);
+    result["lttb_points"] = decimatedTime.size();
+    result["lttb_top100_spikes_kept"] = spikesKept(in, 0, decimatedValue);
+    result["tier"] = static_cast<int>(slice.tier);
+    result["tier_avg_top100_spikes_kept"] =
+      spikesKept(in, tierFirst, decimateTier(kAvg));
+    result["tier_max_top100_spikes_kept"] =
+      spikesKept(in, tierFirst, decimateTier(kMax));
+    return result;
+  }
+
+  // one live tick per iteration: a new sample arrives, the range moves on by
+  // a pixel and PlotRasterizer draws the frame, either scrolling the last
+  // one and drawing only the new strip or drawing it completely. At 1 Hz the
+  // time per tick is the CPU time per second spent on the graphs.
+  QJsonObject benchmarkStrip(const QSize& size, const bool scrolled, const int ticks)
+  {
+    QCustomPlot plot;
+    QSharedPointer<QCPAxisTickerDateTime> ticker(new QCPAxisTickerDateTime);
+    ticker->setDateTimeFormat("hh:mm");
+    addTrafficGraphs(&plot);
+    configureStatsPlot(&plot, "Traffic", ticker, plot.font());
+    setupStatsLayers(&plot);
+    plot.graph(0)->setVisible(false);
+    plot.graph(1)->setVisible(false);
+    plot.resize(size);
+    plot.show();
+    QApplication::processEvents();
+    plot.replot();
+
+    // one sample per pixel, as the live view with a span matching its width
+    const int window = plot.axisRect()->width();
+    QVector<double> time, in, out;
+    syntheticTraffic(window + ticks + 1, time, in, out);
+    plot.graph(0)->setData(time.mid(0, window + 1), out.mid(0, window + 1), true);
+    plot.graph(1)->setData(time.mid(0, window + 1), in.mid(0, window + 1), true);
+    plot.xAxis->setRange(time[window] - window, time[window]);
+    plot.yAxis->setRange(0, (std::max)(
+      *std::max_element(in.begin(), in.end()), *std::max_element(out.begin(), out.end())));
+
+    PlotRasterizer rasterizer;
+    QEventLoop loop;
+    QObject::connect(&rasterizer, &PlotRasterizer::frameReady, [&](const PlotFrame&)
+    {
+      loop.quit();
+    });
+    rasterizer.submit(snapshotGraphs(&plot, -std::numeric_limits<double>::infinity()));
+    loop.exec();
+
+    int tick = window + 1;
+    const auto timing = measure(ticks, [&]
+    {
+      plot.graph(0)->addData(time[tick], out[tick]);
+      plot.graph(1)->addData(time[tick], in[tick]);
+      plot.graph(0)->data()->removeBefore(time[tick - window - 1]);
+      plot.graph(1)->data()->removeBefore(time[tick - window - 1]);
+      plot.xAxis->setRange(time[tick] - window, time[tick]);
+      // the segment to the new sample starts at the one before
+      rasterizer.submit(snapshotGraphs(&plot,
+        scrolled ? time[tick - 1] : -std::numeric_limits<double>::infinity()));
+      loop.exec();
+      ++tick;
+    });
+
+    QJsonObject result;
+    result["scenario"] = QString("strip");
+    result["points"] = window;
+    result["width"] = size.width();
+    result["height"] = size.height();
+    result["scrolled"] = scrolled;
+    result["ticks"] = ticks;
+    result["scrolled_ticks"] = static_cast<double>(rasterizer.scrolledFrames());
+    result["tick"] = toJson(timing);
+    return result;
+  }
+
+  // one update per iteration with the graphs drawn by PlotRasterizer: the GUI
+  // thread only copies the graphs and later blits the finished frame, the
+  // time in between is spent on the worker
+  QJsonObject benchmarkRasterized(const int numPoints, const QSize& size,
+    const int iterations)
+  {
+    QCustomPlot plot;
+    QSharedPointer<QCPAxisTickerDateTime> ticker(new QCPAxisTickerDateTime);
+    ticker->setDateTimeFormat("hh:mm");
+    addTrafficGraphs(&plot);
+    configureStatsPlot(&plot, "Traffic", ticker, plot.font());
+    const auto layer = setupStatsLayers(&plot);
+    plot.resize(size);
+    plot.show();
+    QApplication::processEvents();
+
+    QVector<double> time, in, out;
+    syntheticTraffic(numPoints, time, in, out);
+    plot.graph(0)->setData(time, out, true);
+    plot.graph(1)->setData(time, in, true);
+    plot.graph(0)->setVisible(false);
+    plot.graph(1)->setVisible(false);
+    plot.xAxis->setRange(time.first(), time.last());
+    plot.yAxis->setRange(0, (std::max)(
+      *std::max_element(in.begin(), in.end()), *std::max_element(out.begin(), out.end())));
+    auto frameLayerable = new PlotFrameLayerable(plot.axisRect(), layer->name());
+    plot.replot();
+
+    PlotRasterizer rasterizer;
+    PlotFrame frame;
+    QEventLoop loop;
+    QObject::connect(&rasterizer, &PlotRasterizer::frameReady, [&](const PlotFrame& ready)
+    {
+      frame = ready;
+      loop.quit();
+    });
+
+    std::vector<double> submitMs, blitMs, latencyMs;
+    QElapsedTimer timer;
+    for (int run = 0; run < iterations; ++run)
+    {
+      timer.start();
+      rasterizer.submit(snapshotGraphs(&plot, -std::numeric_limits<double>::infinity()));
+      submitMs.push_back(timer.nsecsElapsed() / 1e6);
+      loop.exec();
+      latencyMs.push_back(timer.nsecsElapsed() / 1e6);
+      timer.start();
+      frameLayerable->setFrame(frame);
+      layer->replot();
+      plot.repaint();
+      blitMs.push_back(timer.nsecsElapsed() / 1e6);
+    }
+    const auto median = [](std::vector<double>& samples)
+    {
+      std::sort(samples.begin(), samples.end());
+      return samples[samples.size() / 2];
+    };
+
+    QJsonObject result;
+    result["scenario"] = QString("rasterized");
+    result["points"] = numPoints;
+    result["width"] = size.width();
+    result["height"] = size.height();
+    result["iterations"] = iterations;
+    result["gui_submit_median_ms"] = median(submitMs);
+    result["gui_blit_median_ms"] = median(blitMs);
+    result["frame_latency_median_ms"] = median(latencyMs);
+    result["rendered_frames"] = static_cast<double>(rasterizer.renderedFrames());
+    return result;
+  }
+
+  // pan and zoom gestures over a week of 1 Hz traffic, each answered like
+  // StatsWidget::browsePlot does: range query, slice loaded into the graphs,
+  // frame drawn by the rasterizer and blitted. The latency is the time from
+  // the gesture until the frame is on the plot.
+  QJsonObject benchmarkBrowse(const QSize& size, const int gestures)
+  {
+    const int numPoints = 7 * 24 * 3600;
+    QVector<double> time, in, out;
+    syntheticTraffic(numPoints, time, in, out);
+    StatsHistory<2> history(1.0);
+    for (int idx = 0; idx < numPoints; ++idx)
+    {
+      history.push(time[idx], {{in[idx], out[idx]}});
+    }
+
+    QCustomPlot plot;
+    QSharedPointer<QCPAxisTickerDateTime> ticker(new QCPAxisTickerDateTime);
+    ticker->setDateTimeFormat("hh:mm");
+    addTrafficGraphs(&plot);
+    configureStatsPlot(&plot, "Traffic", ticker, plot.font());
+    const auto layer = setupStatsLayers(&plot);
+    plot.graph(0)->setVisible(false);
+    plot.graph(1)->setVisible(false);
+    auto frameLayerable = new PlotFrameLayerable(plot.axisRect(), layer->name());
+    plot.resize(size);
+    plot.show();
+    QApplication::processEvents();
+
+    PlotRasterizer rasterizer;
+    PlotFrame frame;
+    QEventLoop loop;
+    QObject::connect(&rasterizer, &PlotRasterizer::frameReady, [&](const PlotFrame& ready)
+    {
+      frame = ready;
+      loop.quit();
+    });
+
+    // zoom out from the last hour to the whole week, then pan back through it
+    std::vector<QCPRange> views;
+    for (double span = 3600; span < numPoints && static_cast<int>(views.size()) < gestures;
+      span *= 1.25)
+    {
+      views.emplace_back(time.last() - span, time.last());
+    }
+    for (double upper = time.last(); static_cast<int>(views.size()) < gestures;
+      upper -= 1800)
+    {
+      views.emplace_back(upper - 6 * 3600, upper);
+    }
+
+    const std::size_t maxPoints = 2 * plot.width();
+    std::vector<double> queryMs, latencyMs;
+    QElapsedTimer timer;
+    for (const auto& view : views)
+    {
+      timer.start();
+      const auto slice = history.slice(view.lower, view.upper, maxPoints * 8);
+      plot.xAxis->setRange(view);
+      // the history holds in and out, graph(0) is outgoing traffic
+      plot.yAxis->setRange(loadHistorySlice(&plot, history, slice, {1, 0}, view,
+        maxPoints));
+      rasterizer.submit(snapshotGraphs(&plot, -std::numeric_limits<double>::infinity()));
+      queryMs.push_back(timer.nsecsElapsed() / 1e6);
+      loop.exec();
+      frameLayerable->setFrame(frame);
+      plot.replot(QCustomPlot::rpImmediateRefresh);
+      latencyMs.push_back(timer.nsecsElapsed() / 1e6);
+    }
+    std::sort(queryMs.begin(), queryMs.end());
+    std::sort(latencyMs.begin(), latencyMs.end());
+
+    QJsonObject result;
+    result["scenario"] = QString("browse");
+    result["points"] = numPoints;
+    result["width"] = size.width();
+    result["height"] = size.height();
+    result["gestures"] = static_cast<int>(views.size());
+    result["gui_query_median_ms"] = queryMs[queryMs.size() / 2];
+    result["latency_median_ms"] = latencyMs[latencyMs.size() / 2];
+    result["latency_max_ms"] = latencyMs.back();
+    result["history_bytes"] = static_cast<double>(history.memoryUsage());
+    return result;
+  }
+} // anon
+
+//------------------------------------------------------------------------------------//
+
+int main(int argc, char *argv[])
+{
+  if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+  {
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  }
+  QApplication app(argc, argv);
+  auto args = app.arguments();
+  args.removeFirst();
+  const bool quick = args.removeAll("--quick") > 0;
+
+  const std::vector<int> sizes = quick ?
+    std::vector<int>{1000, 100000} : std::vector<int>{1000, 100000, 1000000};
+  const std::vector<QSize> widgetSizes{QSize(400, 200), QSize(1600, 600)};
+
+  QJsonArray results;
+  for (const auto numPoints : sizes)
+  {
+    const int iterations = numPoints >= 1000000 ? 5 : 20;
+    for (const auto& size : widgetSizes)
+    {
+      for (const bool antialiasing : {false, true})
+      {
+        for (const bool adaptiveSampling : {true, false})
+        {
+          results.append(benchmarkRender(numPoints, size, antialiasing,
+            adaptiveSampling, iterations));
+          std::cerr << "." << std::flush;
+        }
+      }
+    }
+    results.append(benchmarkIngest(numPoints, numPoints >= 1000000 ? 3 : 10));
+    results.append(benchmarkValueRange(numPoints, iterations));
+    results.append(benchmarkRenderSimd(numPoints, QSize(1600, 600), iterations));
+    results.append(benchmarkDecimation(numPoints, QSize(1600, 600), iterations));
+    results.append(benchmarkRasterized(numPoints, QSize(1600, 600), iterations));
+    for (const bool incremental : {false, true})
+    {
+      results.append(benchmarkFeed(numPoints, QSize(1600, 600), incremental, iterations));
+    }
+    for (const bool bounded : {false, true})
+    {
+      results.append(benchmarkStreaming(numPoints, bounded, 10 * numPoints));
+    }
+  }
+  results.append(benchmarkIngestGaps(quick ? 3 : 10));
+  for (const auto& size : widgetSizes)
+  {
+    for (const bool scrolled : {false, true})
+    {
+      results.append(benchmarkStrip(size, scrolled, quick ? 100 : 500));
+    }
+    results.append(benchmarkBrowse(size, quick ? 40 : 200));
+  }
+  std::cerr << std::endl;
+
+  QJsonObject report;
+  report["benchmark"] = QString("statsplot");
+  report["qt_version"] = QString(qVersion());
+  report["platform"] = QApplication::platformName();
+  // QCP_DISABLE_SIMD=1 forces the scalar min/max kernels of QCPGraph for all
+  // but the render_simd scenario, which switches them itself
+  report["simd"] = qcpSimdEnabled();
+  report["results"] = results;
+  const auto json = QJsonDocument(report).toJson();
+
+  if (args.isEmpty())
+  {
+    std::cout << json.toStdString();
+    return 0;
+  }
+  QFile file(args.first());
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+  {
+    std::cerr << "Unable to write benchmark results: "
+      << file.errorString().toStdString() << std::endl;
+    return 1;
+  }
+  file.write(json);
+  return 0;
+}
@@ -638,6 +638,23 @@ void QCPAbstractPaintBuffer::setDevicePixelRatio(double ratio)
   }
 }
 
+/*!
+  Shifts the contents of the buffer inside \a rect by \a dx and \a dy pixels. The parts of \a rect
+  that are uncovered by the shift keep their old contents and must be redrawn by the caller.
+
+  This lets a strip chart drawn into a \ref QCPPaintBufferImage redraw only the uncovered strip
+  when its key range moved by whole pixels. Returns false if the buffer can't scroll its contents,
+  in which case the buffer is left untouched and the caller must redraw everything. The default
+  implementation does nothing and returns false.
+*/
+bool QCPAbstractPaintBuffer::scroll(int dx, int dy, const QRect &rect)
+{
+  Q_UNUSED(dx)
+  Q_UNUSED(dy)
+  Q_UNUSED(rect)
+  return false;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////// QCPPaintBufferPixmap
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -707,6 +724,101 @@ void QCPPaintBufferPixmap::reallocateBuffer()
 }
 
 
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////// QCPPaintBufferImage
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*! \class QCPPaintBufferImage
+  \brief A paint buffer based on QImage, using software raster rendering
+
+  Unlike QPixmap, QImage may be painted on outside of the GUI thread. This paint buffer therefore
+  allows rendering parts of a plot in a worker thread, and handing the result to the GUI thread via
+  \ref image, which returns an implicitly shared copy. It is not used by QCustomPlot itself.
+*/
+
+/*!
+  Creates an image paint buffer instance with the specified \a size and \a devicePixelRatio, if
+  applicable.
+*/
+QCPPaintBufferImage::QCPPaintBufferImage(const QSize &size, double devicePixelRatio) :
+  QCPAbstractPaintBuffer(size, devicePixelRatio)
+{
+  QCPPaintBufferImage::reallocateBuffer();
+}
+
+QCPPaintBufferImage::~QCPPaintBufferImage()
+{
+}
+
+/* inherits documentation from base class */
+QCPPainter *QCPPaintBufferImage::startPainting()
+{
+  QCPPainter *result = new QCPPainter(&mBuffer);
+  result->setRenderHint(QPainter::HighQualityAntialiasing);
+  return result;
+}
+
+/* inherits documentation from base class */
+void QCPPaintBufferImage::draw(QCPPainter *painter) const
+{
+  if (painter && painter->isActive())
+    painter->drawImage(0, 0, mBuffer);
+  else
+    qDebug() << Q_FUNC_INFO << "invalid or inactive painter passed";
+}
+
+/* inherits documentation from base class */
+void QCPPaintBufferImage::clear(const QColor &color)
+{
+  mBuffer.fill(color);
+}
+
+/* inherits documentation from base class */
+bool QCPPaintBufferImage::scroll(int dx, int dy, const QRect &rect)
+{
+  const int ratio = qRound(mDevicePixelRatio);
+  if (ratio < 1 || !qFuzzyCompare(mDevicePixelRatio, double(ratio)))
+    return false;
+  // QImage has no scroll, move the overlapping part of the rect row by row
+  const QRect deviceRect = QRect(rect.topLeft()*ratio, rect.size()*ratio).intersected(mBuffer.rect());
+  const QRect target = deviceRect.translated(dx*ratio, dy*ratio).intersected(deviceRect);
+  if (target.isEmpty())
+    return true;
+  const QRect source = target.translated(-dx*ratio, -dy*ratio);
+  uchar *bits = mBuffer.bits(); // detaches from frames handed out by image()
+  const int bytesPerLine = mBuffer.bytesPerLine();
+  const int bytesPerPixel = mBuffer.depth()/8;
+  const int rowBytes = target.width()*bytesPerPixel;
+  for (int row=0; row<target.height(); ++row)
+  {
+    const int y = dy > 0 ? target.height()-1-row : row; // don't overwrite rows that are still to be moved
+    memmove(bits + (target.top()+y)*bytesPerLine + target.left()*bytesPerPixel,
+            bits + (source.top()+y)*bytesPerLine + source.left()*bytesPerPixel, rowBytes);
+  }
+  return true;
+}
+
+/* inherits documentation from base class */
+void QCPPaintBufferImage::reallocateBuffer()
+{
+  setInvalidated();
+  if (!qFuzzyCompare(1.0, mDevicePixelRatio))
+  {
+#ifdef QCP_DEVICEPIXELRATIO_SUPPORTED
+    mBuffer = QImage(mSize*mDevicePixelRatio, QImage::Format_ARGB32_Premultiplied);
+    mBuffer.setDevicePixelRatio(mDevicePixelRatio);
+#else
+    qDebug() << Q_FUNC_INFO << "Device pixel ratios not supported for Qt versions before 5.4";
+    mDevicePixelRatio = 1.0;
+    mBuffer = QImage(mSize, QImage::Format_ARGB32_Premultiplied);
+#endif
+  } else
+  {
+    mBuffer = QImage(mSize, QImage::Format_ARGB32_Premultiplied);
+  }
+}
+
+
 #ifdef QCP_OPENGL_PBUFFER
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////// QCPPaintBufferGlPbuffer
@@ -1029,6 +1141,12 @@ void QCPPaintBufferGlFbo::reallocateBuffer()
   Layers with higher indices will be drawn above layers with lower indices.
 */
 
+/*! \fn quint64 QCPLayer::repaintCount() const
+  
+  Returns how often this layer was drawn into its paint buffer. This is
+  meant for diagnostics, e.g. to verify which layers a replot strategy actually touches.
+*/
+
 /* end documentation of inline functions */
 
 /*!
@@ -1045,7 +1163,8 @@ QCPLayer::QCPLayer(QCustomPlot *parentPlot, const QString &layerName) :
   mName(layerName),
   mIndex(-1), // will be set to a proper value by the QCustomPlot layer creation function
   mVisible(true),
-  mMode(lmLogical)
+  mMode(lmLogical),
+  mRepaintCount(0)
 {
   // Note: no need to make sure layerName is unique, because layer
   // management is done with QCustomPlot functions.
@@ -1145,8 +1264,10 @@ void QCPLayer::drawToPaintBuffer()
     if (QCPPainter *painter = mPaintBuffer.data()->startPainting())
     {
       if (painter->isActive())
+      {
         draw(painter);
-      else
+        ++mRepaintCount;
+      } else
         qDebug() << Q_FUNC_INFO << "paint buffer returned inactive painter";
       delete painter;
       mPaintBuffer.data()->donePainting();
@@ -1181,7 +1302,7 @@ void QCPLayer::replot()
       mParentPlot->update();
     } else
       qDebug() << Q_FUNC_INFO << "no valid paint buffer associated with this layer";
-  } else if (mMode == lmLogical)
+  } else
     mParentPlot->replot();
 }
 
@@ -6023,6 +6144,7 @@ double QCPAxisTickerDateTime::dateTimeToKey(const QDate date)
 /* end of 'src/axis/axistickerdatetime.cpp' */
 
 
+#ifndef QCP_NO_EXTRA_TICKERS
 /* including file 'src/axis/axistickertime.cpp', size 11747                  */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -6270,8 +6392,10 @@ void QCPAxisTickerTime::replaceUnit(QString &text, QCPAxisTickerTime::TimeUnit u
   text.replace(mFormatPattern.value(unit), valueStr);
 }
 /* end of 'src/axis/axistickertime.cpp' */
+#endif // QCP_NO_EXTRA_TICKERS
 
 
+#ifndef QCP_NO_EXTRA_TICKERS
 /* including file 'src/axis/axistickerfixed.cpp', size 5583                  */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -6372,8 +6496,10 @@ double QCPAxisTickerFixed::getTickStep(const QCPRange &range)
   return mTickStep;
 }
 /* end of 'src/axis/axistickerfixed.cpp' */
+#endif // QCP_NO_EXTRA_TICKERS
 
 
+#ifndef QCP_NO_EXTRA_TICKERS
 /* including file 'src/axis/axistickertext.cpp', size 8653                   */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -6585,8 +6711,10 @@ QVector<double> QCPAxisTickerText::createTickVector(double tickStep, const QCPRa
   return result;
 }
 /* end of 'src/axis/axistickertext.cpp' */
+#endif // QCP_NO_EXTRA_TICKERS
 
 
+#ifndef QCP_NO_EXTRA_TICKERS
 /* including file 'src/axis/axistickerpi.cpp', size 11170                    */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -6872,8 +7000,10 @@ QString QCPAxisTickerPi::unicodeSubscript(int number) const
   return result;
 }
 /* end of 'src/axis/axistickerpi.cpp' */
+#endif // QCP_NO_EXTRA_TICKERS
 
 
+#ifndef QCP_NO_EXTRA_TICKERS
 /* including file 'src/axis/axistickerlog.cpp', size 7106                    */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -7013,6 +7143,7 @@ QVector<double> QCPAxisTickerLog::createTickVector(double tickStep, const QCPRan
   return result;
 }
 /* end of 'src/axis/axistickerlog.cpp' */
+#endif // QCP_NO_EXTRA_TICKERS
 
 
 /* including file 'src/axis/axis.cpp', size 94458                            */
@@ -15446,6 +15577,7 @@ void QCustomPlot::toPainter(QCPPainter *painter, int width, int height)
 
 //amalgamation: add plottable1d.cpp
 
+#ifndef QCP_NO_COLORMAP
 /* including file 'src/colorgradient.cpp', size 24646                        */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -16084,6 +16216,7 @@ void QCPColorGradient::updateColorBuffer()
   mColorBufferInvalidated = false;
 }
 /* end of 'src/colorgradient.cpp' */
+#endif // QCP_NO_COLORMAP
 
 
 /* including file 'src/selectiondecorator-bracket.cpp', size 12313           */
@@ -18962,6 +19095,7 @@ QColor QCPTextElement::mainTextColor() const
 /* end of 'src/layoutelements/layoutelement-textelement.cpp' */
 
 
+#ifndef QCP_NO_COLORMAP
 /* including file 'src/layoutelements/layoutelement-colorscale.cpp', size 25910 */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200    */
 
@@ -19620,6 +19754,7 @@ void QCPColorScaleAxisRectPrivate::axisSelectableChanged(QCPAxis::SelectablePart
   }
 }
 /* end of 'src/layoutelements/layoutelement-colorscale.cpp' */
+#endif // QCP_NO_COLORMAP
 
 
 /* including file 'src/plottables/plottable-graph.cpp', size 72363           */
@@ -19715,6 +19850,249 @@ QCPGraphData::QCPGraphData(double key, double value) :
 }
 
 
+/*! \internal
+
+  Value min/max kernels over contiguous runs of QCPGraphData, used by adaptive sampling in \ref
+  QCPGraph::getOptimizedLineData and by \ref qcpFindValueRange.
+
+  Every kernel updates \a min and \a max exactly like the scalar loop "if (value < min) min =
+  value; if (value > max) max = value;": NaN values are skipped and a NaN seed stays NaN. This
+  holds for the vector kernels because (v)minpd and (v)maxpd return their second operand if either
+  operand is NaN, so the accumulator is always passed second. Values are extracted from the
+  interleaved key/value pairs with unpackhi, two points per register for SSE2 and four for AVX.
+  The AVX kernel is selected at runtime if CPU and OS support it, SSE2 is the x86 baseline and
+  other architectures use the scalar loop.
+
+  The vector kernels may only differ from the scalar loop in which of several equal extremes they
+  report, which is observable solely for +0.0 versus -0.0.
+
+  The kernel is chosen on first use and can be switched at runtime with \ref qcpSetSimdEnabled.
+*/
+
+#include <atomic>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define QCP_SIMD_X86
+#  include <immintrin.h>
+#  if defined(_MSC_VER)
+#    include <intrin.h>
+#    define QCP_TARGET_AVX
+#  else
+#    define QCP_TARGET_AVX __attribute__((target("avx")))
+#  endif
+#endif
+
+namespace {
+
+typedef void (*QCPValueMinMaxKernel)(const QCPGraphData *begin, const QCPGraphData *end, double &min, double &max);
+
+void qcpValueMinMaxScalar(const QCPGraphData *begin, const QCPGraphData *end, double &min, double &max)
+{
+  for (const QCPGraphData *it = begin; it != end; ++it)
+  {
+    if (it->value < min)
+      min = it->value;
+    if (it->value > max)
+      max = it->value;
+  }
+}
+
+#ifdef QCP_SIMD_X86
+/*! \internal
+  Folds the vector accumulators into \a min and \a max with the same comparisons as the scalar loop.
+*/
+void qcpReduceLanes(const double *minLanes, const double *maxLanes, int count, double &min, double &max)
+{
+  for (int lane = 0; lane < count; ++lane)
+  {
+    if (minLanes[lane] < min)
+      min = minLanes[lane];
+    if (maxLanes[lane] > max)
+      max = maxLanes[lane];
+  }
+}
+
+void qcpValueMinMaxSse2(const QCPGraphData *begin, const QCPGraphData *end, double &min, double &max)
+{
+  const double *data = &begin->key;
+  const int count = end-begin;
+  int i = 0;
+  if (count >= 4)
+  {
+    // two independent accumulators per extreme hide the latency of minpd/maxpd
+    __m128d min0 = _mm_set1_pd(min), min1 = min0;
+    __m128d max0 = _mm_set1_pd(max), max1 = max0;
+    for (; i+4 <= count; i += 4)
+    {
+      const __m128d values0 = _mm_unpackhi_pd(_mm_loadu_pd(data+2*i), _mm_loadu_pd(data+2*i+2));
+      const __m128d values1 = _mm_unpackhi_pd(_mm_loadu_pd(data+2*i+4), _mm_loadu_pd(data+2*i+6));
+      min0 = _mm_min_pd(values0, min0);
+      max0 = _mm_max_pd(values0, max0);
+      min1 = _mm_min_pd(values1, min1);
+      max1 = _mm_max_pd(values1, max1);
+    }
+    double minLanes[4], maxLanes[4];
+    _mm_storeu_pd(minLanes, min0);
+    _mm_storeu_pd(minLanes+2, min1);
+    _mm_storeu_pd(maxLanes, max0);
+    _mm_storeu_pd(maxLanes+2, max1);
+    qcpReduceLanes(minLanes, maxLanes, 4, min, max);
+  }
+  qcpValueMinMaxScalar(begin+i, end, min, max);
+}
+
+QCP_TARGET_AVX void qcpValueMinMaxAvx(const QCPGraphData *begin, const QCPGraphData *end, double &min, double &max)
+{
+  const double *data = &begin->key;
+  const int count = end-begin;
+  int i = 0;
+  if (count >= 8)
+  {
+    __m256d min0 = _mm256_set1_pd(min), min1 = min0;
+    __m256d max0 = _mm256_set1_pd(max), max1 = max0;
+    for (; i+8 <= count; i += 8)
+    {
+      // unpackhi works per 128 bit lane, the values end up as v0 v2 v1 v3, which doesn't matter here
+      const __m256d values0 = _mm256_unpackhi_pd(_mm256_loadu_pd(data+2*i), _mm256_loadu_pd(data+2*i+4));
+      const __m256d values1 = _mm256_unpackhi_pd(_mm256_loadu_pd(data+2*i+8), _mm256_loadu_pd(data+2*i+12));
+      min0 = _mm256_min_pd(values0, min0);
+      max0 = _mm256_max_pd(values0, max0);
+      min1 = _mm256_min_pd(values1, min1);
+      max1 = _mm256_max_pd(values1, max1);
+    }
+    double minLanes[8], maxLanes[8];
+    _mm256_storeu_pd(minLanes, min0);
+    _mm256_storeu_pd(minLanes+4, min1);
+    _mm256_storeu_pd(maxLanes, max0);
+    _mm256_storeu_pd(maxLanes+4, max1);
+    qcpReduceLanes(minLanes, maxLanes, 8, min, max);
+  }
+  qcpValueMinMaxScalar(begin+i, end, min, max);
+}
+
+bool qcpCpuHasAvx()
+{
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 1);
+  const bool osSavesYmm = (info[2] & (1 << 27)) && (_xgetbv(0) & 6) == 6;
+  return osSavesYmm && (info[2] & (1 << 28));
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx");
+#endif
+}
+#endif // QCP_SIMD_X86
+
+QCPValueMinMaxKernel qcpSelectValueMinMaxKernel(bool simd)
+{
+#ifdef QCP_SIMD_X86
+  if (simd)
+    return qcpCpuHasAvx() ? qcpValueMinMaxAvx : qcpValueMinMaxSse2;
+#else
+  Q_UNUSED(simd)
+#endif
+  return qcpValueMinMaxScalar;
+}
+
+// null until first use, see qcpCurrentValueMinMaxKernel
+std::atomic<QCPValueMinMaxKernel> qcpValueMinMaxKernel(nullptr);
+
+/*! \internal
+  Returns the kernel in use. Unless set by \ref qcpSetSimdEnabled, the first call picks the fastest
+  one of the CPU, or the scalar kernel if the environment variable QCP_DISABLE_SIMD is set.
+*/
+QCPValueMinMaxKernel qcpCurrentValueMinMaxKernel()
+{
+  QCPValueMinMaxKernel kernel = qcpValueMinMaxKernel.load(std::memory_order_relaxed);
+  if (!kernel)
+  {
+    QCPValueMinMaxKernel selected = qcpSelectValueMinMaxKernel(qgetenv("QCP_DISABLE_SIMD").isEmpty());
+    // a kernel set meanwhile by qcpSetSimdEnabled wins
+    kernel = qcpValueMinMaxKernel.compare_exchange_strong(kernel, selected, std::memory_order_relaxed) ? selected : kernel;
+  }
+  return kernel;
+}
+
+/*! \internal
+  Updates \a min and \a max with the values of [\a begin, \a end), see the kernels above.
+*/
+inline void qcpValueMinMax(const QCPGraphData *begin, const QCPGraphData *end, double &min, double &max)
+{
+  const QCPValueMinMaxKernel kernel = qcpCurrentValueMinMaxKernel();
+  if (end-begin < 8) // not worth the indirect call
+    qcpValueMinMaxScalar(begin, end, min, max);
+  else
+    kernel(begin, end, min, max);
+}
+
+/*! \internal
+  Returns the first iterator in [\a begin, \a end) whose key is not smaller than \a key. Unlike a
+  plain binary search, it gallops from \a begin, so it costs O(log n) in the distance to the
+  result rather than in the size of the range, which keeps sparse data as cheap as a linear scan.
+*/
+QCPGraphDataContainer::const_iterator qcpGallopLowerBound(QCPGraphDataContainer::const_iterator begin, QCPGraphDataContainer::const_iterator end, double key)
+{
+  int step = 1;
+  QCPGraphDataContainer::const_iterator low = begin;
+  while (end-low > step && (low+step)->key < key)
+  {
+    low += step;
+    step *= 2;
+  }
+  QCPGraphDataContainer::const_iterator high = end-low > step ? low+step+1 : end;
+  return std::lower_bound(low, high, QCPGraphData::fromSortKey(key), qcpLessThanSortKey<QCPGraphData>);
+}
+
+} // anonymous namespace
+
+/*!
+  Switches the value min/max kernels used by \ref QCPGraph and \ref qcpFindValueRange between the
+  vectorized ones of the current CPU and the scalar loop, e.g. to compare both in one process. On
+  CPUs without vector kernels \a enabled has no effect. Takes precedence over the environment
+  variable QCP_DISABLE_SIMD.
+
+  \see qcpSimdEnabled
+*/
+void qcpSetSimdEnabled(bool enabled)
+{
+  qcpValueMinMaxKernel.store(qcpSelectValueMinMaxKernel(enabled), std::memory_order_relaxed);
+}
+
+/*!
+  Returns whether the value min/max kernels in use are vectorized.
+
+  \see qcpSetSimdEnabled
+*/
+bool qcpSimdEnabled()
+{
+  return qcpCurrentValueMinMaxKernel() != qcpValueMinMaxScalar;
+}
+
+/*!
+  Finds the range spanned by the values of the points in [\a begin, \a end), ignoring NaN values,
+  with the vectorized kernel of the current CPU. Sets \a foundRange to whether any non-NaN value was
+  found and leaves \a range untouched otherwise. Always returns true, as the overload for \ref
+  QCPGraphData always handles the search. Used by \ref QCPDataContainer::valueRange.
+*/
+bool qcpFindValueRange(const QCPGraphData *begin, const QCPGraphData *end, QCPRange &range, bool &foundRange)
+{
+  const QCPGraphData *it = begin;
+  while (it != end && qIsNaN(it->value))
+    ++it;
+  foundRange = it != end;
+  if (foundRange)
+  {
+    double min = it->value;
+    double max = it->value;
+    qcpValueMinMax(it+1, end, min, max);
+    range.lower = min;
+    range.upper = max;
+  }
+  return true;
+}
+
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////// QCPGraph
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -20592,13 +20970,13 @@ void QCPGraph::getOptimizedLineData(QVector<QCPGraphData> *lineData, const QCPGr
     ++it; // advance iterator to second data point because adaptive sampling works in 1 point retrospect
     while (it != end)
     {
-      if (it->key < currentIntervalStartKey+keyEpsilon) // data point is still within same pixel, so skip it and expand value span of this cluster if necessary
+      if (it->key < currentIntervalStartKey+keyEpsilon) // data points are still within same pixel, so skip them and expand value span of this cluster if necessary
       {
-        if (it->value < minValue)
-          minValue = it->value;
-        else if (it->value > maxValue)
-          maxValue = it->value;
-        ++intervalDataCount;
+        QCPGraphDataContainer::const_iterator intervalEnd = qcpGallopLowerBound(it, end, currentIntervalStartKey+keyEpsilon);
+        qcpValueMinMax(&*it, &*it+(intervalEnd-it), minValue, maxValue);
+        intervalDataCount += intervalEnd-it;
+        it = intervalEnd;
+        continue;
       } else // new pixel interval started
       {
         if (intervalDataCount >= 2) // last pixel had multiple data points, consolidate them to a cluster
@@ -21330,6 +21708,7 @@ int QCPGraph::findIndexBelowY(const QVector<QPointF> *data, double y) const
 /* end of 'src/plottables/plottable-graph.cpp' */
 
 
+#ifndef QCP_NO_CURVE
 /* including file 'src/plottables/plottable-curve.cpp', size 60009           */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -22743,8 +23122,10 @@ double QCPCurve::pointDistance(const QPointF &pixelPoint, QCPCurveDataContainer:
   return qSqrt(minDistSqr);
 }
 /* end of 'src/plottables/plottable-curve.cpp' */
+#endif // QCP_NO_CURVE
 
 
+#ifndef QCP_NO_BARS
 /* including file 'src/plottables/plottable-bars.cpp', size 43512            */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -23911,8 +24292,10 @@ void QCPBars::connectBars(QCPBars *lower, QCPBars *upper)
   }
 }
 /* end of 'src/plottables/plottable-bars.cpp' */
+#endif // QCP_NO_BARS
 
 
+#ifndef QCP_NO_STATISTICALBOX
 /* including file 'src/plottables/plottable-statisticalbox.cpp', size 28622  */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -24565,8 +24948,10 @@ QVector<QLineF> QCPStatisticalBox::getWhiskerBarLines(QCPStatisticalBoxDataConta
   return result;
 }
 /* end of 'src/plottables/plottable-statisticalbox.cpp' */
+#endif // QCP_NO_STATISTICALBOX
 
 
+#ifndef QCP_NO_COLORMAP
 /* including file 'src/plottables/plottable-colormap.cpp', size 47531        */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -25691,8 +26076,10 @@ void QCPColorMap::drawLegendIcon(QCPPainter *painter, const QRectF &rect) const
   */
 }
 /* end of 'src/plottables/plottable-colormap.cpp' */
+#endif // QCP_NO_COLORMAP
 
 
+#ifndef QCP_NO_FINANCIAL
 /* including file 'src/plottables/plottable-financial.cpp', size 42610       */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -26646,8 +27033,10 @@ QRectF QCPFinancial::selectionHitBox(QCPFinancialDataContainer::const_iterator i
     return QRectF(highPixel, keyPixel-keyWidthPixels, lowPixel-highPixel, keyWidthPixels*2).normalized();
 }
 /* end of 'src/plottables/plottable-financial.cpp' */
+#endif // QCP_NO_FINANCIAL
 
 
+#ifndef QCP_NO_ERRORBARS
 /* including file 'src/plottables/plottable-errorbar.cpp', size 37210        */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -27602,8 +27991,10 @@ bool QCPErrorBars::rectIntersectsLine(const QRectF &pixelRect, const QLineF &lin
     return true;
 }
 /* end of 'src/plottables/plottable-errorbar.cpp' */
+#endif // QCP_NO_ERRORBARS
 
 
+#ifndef QCP_NO_EXTRA_ITEMS
 /* including file 'src/items/item-straightline.cpp', size 7592               */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -27783,8 +28174,10 @@ QPen QCPItemStraightLine::mainPen() const
   return mSelected ? mSelectedPen : mPen;
 }
 /* end of 'src/items/item-straightline.cpp' */
+#endif // QCP_NO_EXTRA_ITEMS
 
 
+#ifndef QCP_NO_EXTRA_ITEMS
 /* including file 'src/items/item-line.cpp', size 8498                       */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -28014,8 +28407,10 @@ QPen QCPItemLine::mainPen() const
   return mSelected ? mSelectedPen : mPen;
 }
 /* end of 'src/items/item-line.cpp' */
+#endif // QCP_NO_EXTRA_ITEMS
 
 
+#ifndef QCP_NO_EXTRA_ITEMS
 /* including file 'src/items/item-curve.cpp', size 7159                      */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -28179,8 +28574,10 @@ QPen QCPItemCurve::mainPen() const
   return mSelected ? mSelectedPen : mPen;
 }
 /* end of 'src/items/item-curve.cpp' */
+#endif // QCP_NO_EXTRA_ITEMS
 
 
+#ifndef QCP_NO_EXTRA_ITEMS
 /* including file 'src/items/item-rect.cpp', size 6479                       */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -28336,6 +28733,7 @@ QBrush QCPItemRect::mainBrush() const
   return mSelected ? mSelectedBrush : mBrush;
 }
 /* end of 'src/items/item-rect.cpp' */
+#endif // QCP_NO_EXTRA_ITEMS
 
 
 /* including file 'src/items/item-text.cpp', size 13338                      */
@@ -28686,6 +29084,7 @@ QBrush QCPItemText::mainBrush() const
 /* end of 'src/items/item-text.cpp' */
 
 
+#ifndef QCP_NO_EXTRA_ITEMS
 /* including file 'src/items/item-ellipse.cpp', size 7863                    */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -28872,8 +29271,10 @@ QBrush QCPItemEllipse::mainBrush() const
   return mSelected ? mSelectedBrush : mBrush;
 }
 /* end of 'src/items/item-ellipse.cpp' */
+#endif // QCP_NO_EXTRA_ITEMS
 
 
+#ifndef QCP_NO_EXTRA_ITEMS
 /* including file 'src/items/item-pixmap.cpp', size 10615                    */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -29142,8 +29543,10 @@ QPen QCPItemPixmap::mainPen() const
   return mSelected ? mSelectedPen : mPen;
 }
 /* end of 'src/items/item-pixmap.cpp' */
+#endif // QCP_NO_EXTRA_ITEMS
 
 
+#ifndef QCP_NO_EXTRA_ITEMS
 /* including file 'src/items/item-tracer.cpp', size 14624                    */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -29512,8 +29915,10 @@ QBrush QCPItemTracer::mainBrush() const
   return mSelected ? mSelectedBrush : mBrush;
 }
 /* end of 'src/items/item-tracer.cpp' */
+#endif // QCP_NO_EXTRA_ITEMS
 
 
+#ifndef QCP_NO_EXTRA_ITEMS
 /* including file 'src/items/item-bracket.cpp', size 10687                   */
 /* commit 633339dadc92cb10c58ef3556b55570685fafb99 2016-09-13 23:54:56 +0200 */
 
@@ -29752,5 +30157,6 @@ QPen QCPItemBracket::mainPen() const
     return mSelected ? mSelectedPen : mPen;
 }
 /* end of 'src/items/item-bracket.cpp' */
+#endif // QCP_NO_EXTRA_ITEMS
 
 
@@ -0,0 +1,256 @@
+/******************************************************************************
+ // QSyncthingTray
+ // Copyright (c) Matthias Frick, All rights reserved.
+ //
+ // This library is free software; you can redistribute it and/or
+ // modify it under the terms of the GNU Lesser General Public
+ // License as published by the Free Software Foundation; either
+ // version 3.0 of the License, or (at your option) any later version.
+ //
+ // This library is distributed in the hope that it will be useful,
+ // but WITHOUT ANY WARRANTY; without even the implied warranty of
+ // MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ // Lesser General Public License for more details.
+ //
+ // You should have received a copy of the GNU Lesser General Public
+ // License along with this library.
+ ******************************************************************************/
+
+#include <qst/historylog.h>
+#include <qst/statshistory.hpp>
+#include <QDir>
+#include <QStandardPaths>
+
+#include <array>
+#include <cstring>
+#include <iostream>
+#include <type_traits>
+
+//------------------------------------------------------------------------------------//
+//------------------------------------------------------------------------------------//
+
+namespace
+{
+  struct FileHeader
+  {
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t recordSize;
+    std::uint32_t reserved;
+  };
+
+  const char kMagic[4] = {'Q', 'S', 'T', 'H'};
+  const std::uint32_t kFormatVersion = 1;
+} // anon
+
+namespace qst
+{
+namespace stats
+{
+
+static_assert(sizeof(HistoryRecord) == 24, "HistoryRecord layout changed");
+static_assert(std::is_trivially_copyable<HistoryRecord>::value,
+  "HistoryRecord is written as raw bytes");
+
+//------------------------------------------------------------------------------------//
+//------------------------------------------------------------------------------------//
+
+// the retention of the coarsest tier in 1 Hz traffic and connection
+// samples per file, about 58 MB
+const std::size_t HistoryLog::kMaxFileBytes = static_cast<std::size_t>(
+  kAggregateTiers.back().retention) * 2 * sizeof(HistoryRecord);
+const std::size_t HistoryLog::kMaxPendingRecords = 1024;
+const std::chrono::seconds HistoryLog::kFlushInterval{60};
+
+//------------------------------------------------------------------------------------//
+//------------------------------------------------------------------------------------//
+
+HistoryLog::HistoryLog(const QString& directory) :
+    mFilePath(QDir(directory).filePath("history.bin"))
+  , mRotatedFilePath(QDir(directory).filePath("history.1.bin"))
+  , mLastFlush(std::chrono::steady_clock::now())
+{
+  QDir().mkpath(directory);
+  mPending.reserve(kMaxPendingRecords);
+}
+
+
+//------------------------------------------------------------------------------------//
+
+HistoryLog::~HistoryLog()
+{
+  flush();
+}
+
+
+//------------------------------------------------------------------------------------//
+
+QString HistoryLog::defaultDirectory()
+{
+  return QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation))
+    .filePath("stats");
+}
+
+
+//------------------------------------------------------------------------------------//
+
+void HistoryLog::load(const RecordCallback& callback)
+{
+  // A clock set back while the app ran leaves records that go back in time;
+  // the history only takes samples in order, so those are dropped, as is
+  // everything older than the history keeps anyway.
+  using namespace std::chrono;
+  const auto now = duration_cast<duration<double>>(
+    system_clock::now().time_since_epoch()).count();
+  const auto oldest = now - kAggregateTiers.back().retention;
+  std::array<double, 2> lastTime{{oldest, oldest}};
+  const auto replay = [&](const HistoryRecord& record)
+  {
+    const auto series = static_cast<std::size_t>(record.series);
+    if (series < lastTime.size() && record.time >= lastTime[series])
+    {
+      lastTime[series] = record.time;
+      callback(record);
+    }
+  };
+  readFile(mRotatedFilePath, replay);
+  if (!readFile(mFilePath, replay))
+  {
+    // unreadable or foreign file, start over instead of appending to it
+    QFile::remove(mFilePath);
+  }
+}
+
+
+//------------------------------------------------------------------------------------//
+
+bool HistoryLog::readFile(const QString& path, const RecordCallback& callback)
+{
+  QFile file(path);
+  if (!file.exists())
+  {
+    return true;
+  }
+  if (!file.open(QIODevice::ReadOnly) ||
+      file.size() < static_cast<qint64>(sizeof(FileHeader)))
+  {
+    return false;
+  }
+  uchar* data = file.map(0, file.size());
+  if (data == nullptr)
+  {
+    std::cerr << "Unable to map stats history: "
+      << file.errorString().toStdString() << std::endl;
+    return false;
+  }
+
+  FileHeader header;
+  std::memcpy(&header, data, sizeof(header));
+  const bool valid = std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 &&
+    header.version == kFormatVersion && header.recordSize == sizeof(HistoryRecord);
+  if (valid)
+  {
+    // a trailing partial record from an interrupted write is ignored
+    const auto numRecords =
+      (static_cast<std::size_t>(file.size()) - sizeof(FileHeader)) / sizeof(HistoryRecord);
+    const uchar* records = data + sizeof(FileHeader);
+    HistoryRecord record;
+    for (std::size_t idx = 0; idx < numRecords; ++idx)
+    {
+      std::memcpy(&record, records + idx * sizeof(HistoryRecord), sizeof(record));
+      callback(record);
+    }
+  }
+  file.unmap(data);
+  return valid;
+}
+
+
+//------------------------------------------------------------------------------------//
+
+void HistoryLog::append(const HistoryRecord& record)
+{
+  using namespace std::chrono;
+  mPending.push_back(record);
+  if (mPending.size() >= kMaxPendingRecords ||
+      steady_clock::now() - mLastFlush >= kFlushInterval)
+  {
+    flush();
+  }
+}
+
+
+//------------------------------------------------------------------------------------//
+
+void HistoryLog::flush()
+{
+  mLastFlush = std::chrono::steady_clock::now();
+  if (mPending.empty())
+  {
+    return;
+  }
+  const auto bytes = mPending.size() * sizeof(HistoryRecord);
+  if (mFile.isOpen() && static_cast<std::size_t>(mFile.size()) + bytes > kMaxFileBytes)
+  {
+    rotate();
+  }
+  if (!mFile.isOpen() && !openForAppend())
+  {
+    mPending.clear();
+    return;
+  }
+  // hands the batch to the OS, no fsync: losing the last minute on a crash
+  // is acceptable for statistics
+  mFile.write(reinterpret_cast<const char*>(mPending.data()), bytes);
+  mFile.flush();
+  mPending.clear();
+}
+
+
+//------------------------------------------------------------------------------------//
+
+bool HistoryLog::openForAppend()
+{
+  mFile.setFileName(mFilePath);
+  if (!mFile.open(QIODevice::WriteOnly | QIODevice::Append))
+  {
+    std::cerr << "Unable to open stats history: "
+      << mFile.errorString().toStdString() << std::endl;
+    return false;
+  }
+  if (mFile.size() == 0)
+  {
+    FileHeader header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kFormatVersion;
+    header.recordSize = sizeof(HistoryRecord);
+    header.reserved = 0;
+    mFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  }
+  else
+  {
+    // drop a partial record left behind by an interrupted write
+    const auto payload = mFile.size() - static_cast<qint64>(sizeof(FileHeader));
+    mFile.resize(mFile.size() - payload % static_cast<qint64>(sizeof(HistoryRecord)));
+  }
+  return true;
+}
+
+
+//------------------------------------------------------------------------------------//
+
+void HistoryLog::rotate()
+{
+  mFile.close();
+  QFile::remove(mRotatedFilePath);
+  QFile::rename(mFilePath, mRotatedFilePath);
+}
+
+//------------------------------------------------------------------------------------//
+//------------------------------------------------------------------------------------//
+
+} // stats namespace
+} // qst namespace
+
+//------------------------------------------------------------------------------------//
+//------------------------------------------------------------------------------------//
@@ -0,0 +1,309 @@
+/******************************************************************************
+ // QSyncthingTray
+ // Copyright (c) Matthias Frick, All rights reserved.
+ //
+ // This library is free software; you can redistribute it and/or
+ // modify it under the terms of the GNU Lesser General Public
+ // License as published by the Free Software Foundation; either
+ // version 3.0 of the License, or (at your option) any later version.
+ //
+ // This library is distributed in the hope that it will be useful,
+ // but WITHOUT ANY WARRANTY; without even the implied warranty of
+ // MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ // Lesser General Public License for more details.
+ //
+ // You should have received a copy of the GNU Lesser General Public
+ // License along with this library.
+ ******************************************************************************/
+
+
+#include <qst/plotrasterizer.h>
+
+#include <algorithm>
+#include <cmath>
+
+//------------------------------------------------------------------------------------//
+//------------------------------------------------------------------------------------//
+
+namespace qst
+{
+namespace stats
+{
+
+//------------------------------------------------------------------------------------//
+//------------------------------------------------------------------------------------//
+
+PlotFrameRequest snapshotGraphs(QCustomPlot* plot, const double changedFrom)
+{
+  PlotFrameRequest request;
+  request.size = plot->axisRect()->rect().size();
+  request.devicePixelRatio = plot->bufferDevicePixelRatio();
+  request.keyRange = plot->xAxis->range();
+  request.valueRange = plot->yAxis->range();
+  request.changedFrom = changedFrom;
+  request.graphs.resize(plot->graphCount());
+  for (int idx = 0; idx < plot->graphCount(); ++idx)
+  {
+    const auto graph = plot->graph(idx);
+    auto& snapshot = request.graphs[idx];
+    snapshot.pen = graph->pen();
+    snapshot.keys.reserve(graph->data()->size());
+    snapshot.values.reserve(graph->data()->size());
+    for (auto it = graph->data()->constBegin(); it != graph->data()->constEnd(); ++it)
+    {
+      snapshot.keys.push_back(it->key);
+      snapshot.values.push_back(it->value);
+    }
+  }
+  return request;
+}
+
+//------------------------------------------------------------------------------------//
+//------------------------------------------------------------------------------------//
+
+PlotRasterizer::PlotRasterizer(QObject* parent) :
+  QObject(parent)
+{
+  qRegisterMetaType<PlotFrame>();
+  mThread = std::thread(&PlotRasterizer::run, this);
+}
+
+
+//------------------------------------------------------------------------------------//
+
+PlotRasterizer::~PlotRasterizer()
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStop = true;
+  }
+  mWakeUp.notify_one();
+  mThread.join();
+}
+
+
+//------------------------------------------------------------------------------------//
+
+void PlotRasterizer::submit(PlotFrameRequest request)
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mHasPending)
+    {
+      // the waiting request is never drawn, but what changed with it still
+      // has to be
+      request.changedFrom = (std::min)(request.changedFrom, mPending.changedFrom);
+      mDropped.fetch_add(1, std::memory_order_relaxed);
+    }
+    mPending = std::move(request);
+    mHasPending = true;
+  }
+  mWakeUp.notify_one();
+}
+
+
+//------------------------------------------------------------------------------------//
+
+std::uint64_t PlotRasterizer::renderedFrames() const
+{
+  return mRendered.load(std::memory_order_relaxed);
+}
+
+
+//------------------------------------------------------------------------------------//
+
+std::uint64_t PlotRasterizer::scrolledFrames() const
+{
+  return mScrolled.load(std::memory_order_relaxed);
+}
+
+
+//------------------------------------------------------------------------------------//
+
+std::uint64_t PlotRasterizer::droppedFrames() const
+{
+  return mDropped.load(std::memory_order_relaxed);
+}
+
+
+//------------------------------------------------------------------------------------//
+
+void PlotRasterizer::run()
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+  while (true)
+  {
+    mWakeUp.wait(lock, [this] { return mStop || mHasPending; });
+    if (mStop)
+    {
+      return;
+    }
+    const PlotFrameRequest request = std::move(mPending);
+    mHasPending = false;
+    lock.unlock();
+
+    const bool scrolled = render(request);
+    mRendered.fetch_add(1, std::memory_order_relaxed);
+    mScrolled.fetch_add(scrolled ? 1 : 0, std::memory_order_relaxed);
+
+    lock.lock();
+    if (mHasPending)
+    {
+      // stale already, the frame for the newer request follows right away
+      mDropped.fetch_add(1, std::memory_order_relaxed);
+      continue;
+    }
+    lock.unlock();
+    emit frameReady({mpBuffer->image(), request.keyRange, request.valueRange});
+    lock.lock();
+  }
+}
+
+
+//------------------------------------------------------------------------------------//
+
+bool PlotRasterizer::render(const PlotFrameRequest& request)
+{
+  const QRect rect(QPoint(0, 0), request.size);
+  const double width = rect.width();
+  const double height = rect.height();
+  const bool sameBuffer = mpBuffer && mpBuffer->size() == request.size &&
+    mpBuffer->devicePixelRatio() == request.devicePixelRatio;
+  if (!mpBuffer)
+  {
+    mpBuffer.reset(new QCPPaintBufferImage(request.size, request.devicePixelRatio));
+  }
+  mpBuffer->setSize(request.size);
+  mpBuffer->setDevicePixelRatio(request.devicePixelRatio);
+
+  // the old frame can be reused if the graphs only moved by whole pixels
+  const auto& keys = request.keyRange;
+  const auto shift = (keys.upper - mKeyRange.upper) / keys.size() * width;
+  const int dx = -static_cast<int>(std::round(shift));
+  const bool scrollable = sameBuffer && request.valueRange == mValueRange &&
+    std::abs(keys.size() - mKeyRange.size()) <= keys.size() * 1e-9 &&
+    std::abs(shift - std::round(shift)) < 1e-3 && std::abs(dx) < rect.width() &&
+    request.changedFrom > keys.lower;
+  QRect strip = rect;
+  const bool scrolled = scrollable && mpBuffer->scroll(dx, 0, rect);
+  if (scrolled)
+  {
+    const auto repaintWidth = static_cast<int>(
+      std::ceil((keys.upper - request.changedFrom) / keys.size() * width));
+    // one more column, so antialiased lines join seamlessly
+    const int stripWidth = (std::min)((std::max)(std::abs(dx), repaintWidth) + 1, rect.width());
+    strip = dx > 0 ? QRect(0, 0, stripWidth, rect.height()) :
+      QRect(rect.width() - stripWidth, 0, stripWidth, rect.height());
+  }
+  mKeyRange = request.keyRange;
+  mValueRange = request.valueRange;
+
+  QCPPainter* painter = mpBuffer->startPainting();
+  painter->setCompositionMode(QPainter::CompositionMode_Source);
+  painter->fillRect(strip, Qt::transparent);
+  painter->setCompositionMode(QPainter::CompositionMode_SourceOver);
+  painter->setClipRect(strip);
+  painter->setAntialiasing(true);
+  const auto& values = request.valueRange;
+  const auto stripLower = keys.lower + strip.left() / width * keys.size();
+  const auto stripUpper = keys.lower + (strip.right() + 1) / width * keys.size();
+  QPolygonF line;
+  for (const auto& graph : request.graphs)
+  {
+    // the points in the strip and one on either side, whose lines enter it
+    auto first = std::lower_bound(graph.keys.begin(), graph.keys.end(), stripLower);
+    auto last = std::upper_bound(first, graph.keys.end(), stripUpper);
+    first = first == graph.keys.begin() ? first : first - 1;
+    last = last == graph.keys.end() ? last : last + 1;
+    line.clear();
+    for (auto it = first; it != last; ++it)
+    {
+      const auto value = graph.values[static_cast<int>(it - graph.keys.begin())];
+      // same mapping as QCPAxis::coordToPixel, relative to the axis rect
+      line << QPointF((*it - keys.lower) / keys.size() * width,
+        height - 1 - (value - values.lower) / values.size() * height);
+    }
+    painter->setPen(graph.pen);
+    painter->drawPolyline(line);
+  }
+  delete painter;
+  mpBuffer->donePainting();
+  return scrolled;
+}
+
+
+//------------------------------------------------------------------------------------//
+//------------------------------------------------------------------------------------//
+
+PlotFrameLayerable::PlotFrameLayerable(QCPAxisRect* axisRect, const QString& layer) :
+    QCPLayerable(axisRect->parentPlot(), layer)
+  , mpAxisRect(axisRect)
+{
+}
+
+
+//------------------------------------------------------------------------------------//
+
+void PlotFrameLayerable::setFrame(const PlotFrame& frame)
+{
+  mFrame = frame;
+}
+
+
+//------------------------------------------------------------------------------------//
+
+const PlotFrame& PlotFrameLayerable::frame() const
+{
+  return mFrame;
+}
+
+
+//------------------------------------------------------------------------------------//
+
+void PlotFrameLayerable::applyDefaultAntialiasingHint(QCPPainter* painter) const
+{
+  painter->setAntialiasing(false);
+}
+
+
+//------------------------------------------------------------------------------------//
+
+void PlotFrameLayerable::draw(QCPPainter* painter)
+{
+  if (mFrame.image.isNull())
+  {
+    return;
+  }
+  // Drawn where its ranges are on the current axes: while a frame for a new
+  // range or plot size is on its way, the last one is moved and scaled along,
+  // so panning and zooming follow the mouse right away.
+  const auto keyAxis = mpAxisRect->axis(QCPAxis::atBottom);
+  const auto valueAxis = mpAxisRect->axis(QCPAxis::atLeft);
+  QRectF target(mpAxisRect->rect());
+  if (mFrame.keyRange.size() > 0 && mFrame.valueRange.size() > 0)
+  {
+    target.setLeft(keyAxis->coordToPixel(mFrame.keyRange.lower));
+    target.setRight(keyAxis->coordToPixel(mFrame.keyRange.upper));
+    // the value axis maps its lower end onto the last row, not below it
+    target.setTop(valueAxis->coordToPixel(mFrame.valueRange.upper) + 1);
+    target.setBottom(valueAxis->coordToPixel(mFrame.valueRange.lower) + 1);
+  }
+  painter->drawImage(target, mFrame.image);
+}
+
+
+//------------------------------------------------------------------------------------//
+
+QRect PlotFrameLayerable::clipRect() const
+{
+  return mpAxisRect->rect();
+}
+
+//------------------------------------------------------------------------------------//
+//------------------------------------------------------------------------------------//
+
+} // stats namespace
+} // qst namespace
+
+//------------------------------------------------------------------------------------//
+//------------------------------------------------------------------------------------//
@@ -17,19 +17,50 @@
  ******************************************************************************/
 
 #include <qst/statswidget.h>
+#include <qst/statsplot.hpp>
 #include <qst/utilities.hpp>
+#include <QCoreApplication>
 #include <QFileDialog>
 #include <QHBoxLayout>
 #include <QVBoxLayout>
+#include <QWindow>
 #include <QLabel>
 #include <QSpinBox>
+#include <QStringList>
 
 #include <algorithm>
-#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <limits>
 
 //------------------------------------------------------------------------------------//
 //------------------------------------------------------------------------------------//
 
+namespace
+{
+  // seconds since epoch, the unit used by QCPAxisTickerDateTime
+  double toPlotTime(const std::chrono::time_point<std::chrono::system_clock>& time)
+  {
+    using namespace std::chrono;
+    return duration_cast<duration<double>>(time.time_since_epoch()).count();
+  }
+
+  QString formatPercentiles(const QString& name,
+    const qst::stats::PercentileTracker& tracker, const int precision)
+  {
+    using namespace qst::stats;
+    QString row = "<tr><td>" + name + "</td>";
+    for (int window = 0; window < kNumPercentileWindows; ++window)
+    {
+      const auto p = tracker.percentiles(static_cast<PercentileWindow>(window));
+      row += "<td align='right'>" + (p.count == 0 ? QString("-") :
+        QString("%1 / %2 / %3").arg(p.p50, 0, 'f', precision)
+          .arg(p.p95, 0, 'f', precision).arg(p.p99, 0, 'f', precision)) + "</td>";
+    }
+    return row + "</tr>";
+  }
+} // anon
+
 namespace qst
 {
 namespace stats
@@ -38,9 +69,12 @@ namespace stats
 //------------------------------------------------------------------------------------//
 //------------------------------------------------------------------------------------//
 
-const int StatsWidget::kMaxSecBeforeZero = 10;
-const QBrush StatsWidget::kBackgroundColor{QColor(0,0,0,255)};
-const QColor StatsWidget::kForegroundColor{255,255,255,255};
+const double StatsWidget::kMinPollIntervalSec = 0.5;
+const std::size_t StatsWidget::kDecimationOversampling = 8;
+const int StatsWidget::kMinRedrawIntervalMs = 1000;
+const int StatsWidget::kMaxRedrawIntervalMs = 10000;
+const double StatsWidget::kMinBrowseSpanSec = 60;
+const std::size_t StatsWidget::kNumFolderSlots;
 
 //------------------------------------------------------------------------------------//
 //------------------------------------------------------------------------------------//
@@ -57,50 +91,162 @@ StatsWidget::StatsWidget(const QString& title,
   setStyleSheet("background-color:black;");
   mpDateTicker->setDateTimeFormat("hh:mm");
   mpLabel = new QLabel (title);
+  resizeSeries();
+  startHistoryLoad();
+  connect(qApp, &QCoreApplication::aboutToQuit, this, [this]
+  {
+    finishHistoryLoad();
+    drainSamples();
+    mHistoryLog.flush();
+  });
 
   mpCustomPlot = new QCustomPlot();
   mpConnectionPlot = new QCustomPlot();
+  mpFolderPlot = new QCustomPlot();
 
   connect(mpAppSettings.get(), &settings::AppSettings::settingsUpdated,
     this, &StatsWidget::onSettingsChanged);
-  // Traffic Plot
-  mpCustomPlot->addGraph();
-  mpCustomPlot->addGraph();
-
-  mpCustomPlot->graph(0)->setPen(QPen(QColor(255, 0, 0, 255)));
-  mpCustomPlot->graph(0)->setName("Output");
-  mpCustomPlot->graph(1)->setPen(QPen(QColor(0, 255, 255, 255)));
-  mpCustomPlot->graph(1)->setName("Input");
-  mpCustomPlot->xAxis->setLabel("Time");
-  mpCustomPlot->yAxis->setLabel("kb/s");
-
-  // Traffic Plot
-  mpConnectionPlot->addGraph();
-
-  mpConnectionPlot->graph(0)->setPen(QPen(QColor(255, 0, 0, 255)));
-  mpConnectionPlot->graph(0)->setName("Active Connections");
-  mpConnectionPlot->xAxis->setLabel("Time");
-  mpConnectionPlot->yAxis->setLabel("Connections");
+  addTrafficGraphs(mpCustomPlot);
+  addConnectionGraphs(mpConnectionPlot);
+  addFolderGraphs(mpFolderPlot, static_cast<int>(kNumFolderSlots + 1));
+  mpFolderPlot->graph(kNumFolderSlots)->setName(tr("Other"));
 
   const auto timeStr = "(" + QString::number(mMaxTimeInPlotMins/60) + " hr)";
-  configurePlot(mpCustomPlot, "Traffic " + timeStr);
-  configurePlot(mpConnectionPlot, "Connections " + timeStr);
+  configureStatsPlot(mpCustomPlot, "Traffic " + timeStr, mpDateTicker, font());
+  configureStatsPlot(mpConnectionPlot, "Connections " + timeStr, mpDateTicker, font());
+  configureStatsPlot(mpFolderPlot, "Folders " + timeStr, mpDateTicker, font());
+  setupStatsLayers(mpCustomPlot);
+  setupStatsLayers(mpConnectionPlot);
+  for (const auto plot : {mpCustomPlot, mpConnectionPlot})
+  {
+    for (int graph = 0; graph < plot->graphCount(); ++graph)
+    {
+      plot->graph(graph)->setVisible(false);
+    }
+  }
+  mpTrafficFrame = new PlotFrameLayerable(mpCustomPlot->axisRect(), kStripLayerName);
+  mpConnectionFrame = new PlotFrameLayerable(mpConnectionPlot->axisRect(), kStripLayerName);
+  connect(&mTrafficRasterizer, &PlotRasterizer::frameReady, this,
+    [this](const PlotFrame& frame)
+  {
+    showFrame(mpCustomPlot, mpTrafficFrame, frame);
+    updateRepaintOverlay(mpCustomPlot, mpTrafficOverlay);
+  });
+  connect(&mConnectionRasterizer, &PlotRasterizer::frameReady, this,
+    [this](const PlotFrame& frame)
+  {
+    showFrame(mpConnectionPlot, mpConnectionFrame, frame);
+    updateRepaintOverlay(mpConnectionPlot, mpConnectionOverlay);
+  });
+  for (const auto plot : {mpCustomPlot, mpConnectionPlot, mpFolderPlot})
+  {
+    enableHistoryBrowsing(plot);
+    plot->setToolTip(tr("Drag to pan, scroll to zoom, double click to follow live"));
+    connect(plot->xAxis,
+      static_cast<void (QCPAxis::*)(const QCPRange&)>(&QCPAxis::rangeChanged), this,
+      [this](const QCPRange& range)
+    {
+      if (!mSettingRange)
+      {
+        browse(range);
+      }
+    });
+    connect(plot, &QCustomPlot::mouseDoubleClick, this, &StatsWidget::stopBrowsing);
+  }
+  if (!qEnvironmentVariableIsEmpty("QST_STATS_DEBUG"))
+  {
+    mpTrafficOverlay = addRepaintOverlay(mpCustomPlot);
+    mpConnectionOverlay = addRepaintOverlay(mpConnectionPlot);
+  }
+
 
+  mpPercentileLabel = new QLabel();
+  mpPercentileLabel->setStyleSheet("color:white;");
+  mpPercentileLabel->setFont(QFont(font().family(), 9));
+  updatePercentiles();
 
   pLayout->addWidget(mpCustomPlot);
   pLayout->addWidget(mpConnectionPlot);
+  pLayout->addWidget(mpFolderPlot);
+  pLayout->addWidget(mpPercentileLabel);
   setLayout(pLayout);
 }
 
 
+//------------------------------------------------------------------------------------//
+
+StatsWidget::~StatsWidget()
+{
+  if (mHistoryLoader.joinable())
+  {
+    mHistoryLoader.join();
+  }
+}
+
+
+//------------------------------------------------------------------------------------//
+
+void StatsWidget::startHistoryLoad()
+{
+  // A full log holds a few million records, too many to replay while the
+  // tray starts up; the worker only reads the log files, nothing is
+  // appended to them before finishHistoryLoad.
+  mLoadedHistory.reset(new SampleHistory(mHistory));
+  mHistoryLoader = std::thread([this]
+  {
+    mHistoryLog.load([this](const HistoryRecord& record)
+    {
+      mLoadedHistory->add(record);
+    });
+    QMetaObject::invokeMethod(this, "finishHistoryLoad", Qt::QueuedConnection);
+  });
+}
+
+
+//------------------------------------------------------------------------------------//
+
+void StatsWidget::finishHistoryLoad()
+{
+  if (!mHistoryLoader.joinable())
+  {
+    return;
+  }
+  mHistoryLoader.join();
+  mHistory = std::move(*mLoadedHistory);
+  mLoadedHistory.reset();
+  // the settings may have changed while the log was replayed
+  resizeSeries();
+  for (const auto& record : mLoadBacklog)
+  {
+    if (mHistory.add(record))
+    {
+      mHistoryLog.append(record);
+    }
+  }
+  mLoadBacklog.clear();
+  // the graphs no longer hold what the live feed handed them
+  mTrafficFeed.tier = StatsHistory<1>::kNumTiers;
+  mConnectionFeed.tier = StatsHistory<1>::kNumTiers;
+  mTrafficDirty = mConnectionsDirty = true;
+  if (mBrowsing)
+  {
+    browse(mBrowseRange);
+  }
+  updatePercentiles();
+}
+
+
 //------------------------------------------------------------------------------------//
 
 void StatsWidget::onSettingsChanged()
 {
   mMaxTimeInPlotMins = mpAppSettings->value(kStatsLengthId).toInt() * 60;
+  resizeSeries();
+  mTrafficDirty = mConnectionsDirty = mFoldersDirty = true;
   const auto timeStr = "(" + QString::number(mMaxTimeInPlotMins/60) + " hr)";
   updateTitle(mpCustomPlot, "Traffic " + timeStr);
   updateTitle(mpConnectionPlot, "Connections " + timeStr);
+  updateTitle(mpFolderPlot, "Folders " + timeStr);
 }
 
 
@@ -111,43 +257,111 @@ void StatsWidget::updateTitle(QCustomPlot* plot, const QString& title)
   const auto textElement = dynamic_cast<QCPTextElement*>(
     plot->plotLayout()->element(0, 0));
   textElement->setText(title);
+  // the title is on a static layer, only a full replot picks it up
+  plot->replot(QCustomPlot::rpQueuedReplot);
 }
 
 
 //------------------------------------------------------------------------------------//
 
-void StatsWidget::configurePlot(QCustomPlot* plot, const QString& title)
-{
-  plot->yAxis->setNumberFormat("f");
-  plot->yAxis->setNumberPrecision(1);
-  plot->xAxis->setTicker(mpDateTicker);
-  plot->xAxis->setLabelColor(kForegroundColor);
-  plot->yAxis->setLabelColor(kForegroundColor);
-  plot->xAxis->setTickLabelColor(kForegroundColor);
-  plot->yAxis->setTickLabelColor(kForegroundColor);
-  plot->setBackground(kBackgroundColor);
-  plot->legend->setFont(QFont(font().family(), 7));
-  plot->legend->setIconSize(15, 10);
-  plot->legend->setVisible(true);
-  plot->legend->setTextColor(kForegroundColor);
-  plot->legend->setBrush(kBackgroundColor);
-  plot->legend->setBorderPen(QPen(kForegroundColor));
-  plot->xAxis->grid()->setVisible(true);
-  plot->xAxis->grid()->setPen(QPen(kForegroundColor, 0, Qt::DotLine));
-  plot->yAxis->grid()->setVisible(true);
-  plot->yAxis->grid()->setPen(QPen(kForegroundColor, 0, Qt::DotLine));
-  plot->xAxis->setBasePen(QPen(kForegroundColor, 0, Qt::SolidLine));
-  plot->yAxis->setBasePen(QPen(kForegroundColor, 0, Qt::SolidLine));
-
-  plot->setMinimumWidth(400);
-  plot->setMinimumHeight(200);
-  plot->plotLayout()->insertRow(0);
-  plot->plotLayout()->addElement(0, 0,
-    new QCPTextElement(plot, title));
-  auto textElement = dynamic_cast<QCPTextElement*>(
-    plot->plotLayout()->element(0, 0));
-  textElement->setTextColor(kForegroundColor);
+void StatsWidget::setKeyRange(QCustomPlot* plot, const QCPRange& range)
+{
+  // every other change of the time axis comes from the user dragging or
+  // zooming, see browse
+  mSettingRange = true;
+  plot->xAxis->setRange(range);
+  mSettingRange = false;
+}
+
 
+//------------------------------------------------------------------------------------//
+
+void StatsWidget::browse(const QCPRange& range)
+{
+  // all plots follow the range, kept within the retained history
+  QCPRange bounds(std::numeric_limits<double>::infinity(),
+    -std::numeric_limits<double>::infinity());
+  if (!mHistory.traffic.empty())
+  {
+    bounds.lower = (std::min)(bounds.lower, mHistory.traffic.firstTime());
+    bounds.upper = (std::max)(bounds.upper, mHistory.traffic.lastTime());
+  }
+  if (!mHistory.connections.empty())
+  {
+    bounds.lower = (std::min)(bounds.lower, mHistory.connections.firstTime());
+    bounds.upper = (std::max)(bounds.upper, mHistory.connections.lastTime());
+  }
+  if (bounds.lower >= bounds.upper)
+  {
+    return;
+  }
+  auto view = range;
+  if (view.size() < kMinBrowseSpanSec)
+  {
+    view = QCPRange(view.center() - kMinBrowseSpanSec / 2,
+      view.center() + kMinBrowseSpanSec / 2);
+  }
+  if (view.size() >= bounds.size())
+  {
+    view = bounds;
+  }
+  else if (view.lower < bounds.lower)
+  {
+    view += bounds.lower - view.lower;
+  }
+  else if (view.upper > bounds.upper)
+  {
+    view -= view.upper - bounds.upper;
+  }
+  mBrowsing = true;
+  mBrowseRange = view;
+  browsePlot(mpCustomPlot, mHistory.traffic, mTrafficFeed, {kOutColumn, kInColumn},
+    mTrafficRasterizer);
+  browsePlot(mpConnectionPlot, mHistory.connections, mConnectionFeed, {0},
+    mConnectionRasterizer);
+  loadFolderSlice(mBrowseRange);
+}
+
+
+//------------------------------------------------------------------------------------//
+
+void StatsWidget::stopBrowsing()
+{
+  if (!mBrowsing)
+  {
+    return;
+  }
+  mBrowsing = false;
+  mTrafficDirty = mConnectionsDirty = mFoldersDirty = true;
+  updatePlot();
+}
+
+
+//------------------------------------------------------------------------------------//
+
+template<typename Series>
+void StatsWidget::browsePlot(QCustomPlot* plot, const Series& series, PlotFeed& feed,
+  const std::vector<std::size_t>& graphColumns, PlotRasterizer& rasterizer)
+{
+  // The view is answered by a range query on the history instead of the
+  // live feed: only the visible slice of the finest tier that fits is
+  // loaded. Until its frame is ready, the last one is moved and scaled
+  // along, see PlotFrameLayerable.
+  setKeyRange(plot, mBrowseRange);
+  if (!series.empty())
+  {
+    const auto maxPoints = maxPlotPoints(plot);
+    const auto slice = series.slice(mBrowseRange.lower, mBrowseRange.upper,
+      maxPoints * kDecimationOversampling);
+    // the widget may have grown since the last live redraw
+    reserveGraphPoints(plot, maxPoints);
+    plot->yAxis->setRange(
+      loadHistorySlice(plot, series, slice, graphColumns, mBrowseRange, maxPoints));
+    // the graphs no longer hold what the live feed handed them
+    feed.tier = StatsHistory<1>::kNumTiers;
+    rasterizer.submit(snapshotGraphs(plot, -std::numeric_limits<double>::infinity()));
+  }
+  plot->replot(QCustomPlot::rpQueuedReplot);
 }
 
 
@@ -165,7 +379,8 @@ void StatsWidget::show()
   QWidget::show();
   connect(&mRedrawTimer, &QTimer::timeout, this,
     &StatsWidget::updatePlot);
-  mRedrawTimer.start(1000);
+  mRedrawTimer.start(redrawInterval());
+  QTimer::singleShot(0, this, SLOT(updatePlot()));
 }
 
 
@@ -180,34 +395,366 @@ void StatsWidget::closeEvent(QCloseEvent* event)
 }
 
 
+//------------------------------------------------------------------------------------//
+
+void StatsWidget::changeEvent(QEvent* event)
+{
+  QWidget::changeEvent(event);
+  // catch up right away when restored instead of waiting for the next tick
+  if (event->type() == QEvent::WindowStateChange && mRedrawTimer.isActive() &&
+      !isMinimized())
+  {
+    updatePlot();
+  }
+}
+
+
+//------------------------------------------------------------------------------------//
+
+void StatsWidget::resizeEvent(QResizeEvent* event)
+{
+  QWidget::resizeEvent(event);
+  // the width decides which history tier is shown
+  mTrafficDirty = mConnectionsDirty = mFoldersDirty = true;
+}
+
+
+//------------------------------------------------------------------------------------//
+
+bool StatsWidget::isPlotExposed() const
+{
+  const auto window = windowHandle();
+  return isVisible() && !isMinimized() && (window == nullptr || window->isExposed());
+}
+
+
+//------------------------------------------------------------------------------------//
+
+int StatsWidget::redrawInterval() const
+{
+  // redrawing faster than the plot moves by a pixel, or faster than new
+  // samples arrive, shows nothing new
+  const auto pixels = (std::max)(mpCustomPlot->axisRect()->width(), 100);
+  const auto pollInterval = (std::max)(kMinPollIntervalSec,
+    mpAppSettings->value(kPollingIntervalId).toDouble());
+  const auto seconds = (std::max)(mMaxTimeInPlotMins * 60.0 / pixels, pollInterval);
+  return (std::min)(kMaxRedrawIntervalMs,
+    (std::max)(kMinRedrawIntervalMs, static_cast<int>(seconds * 1000)));
+}
+
+
+//------------------------------------------------------------------------------------//
+
+void StatsWidget::resizeSeries()
+{
+  const auto pollInterval = (std::max)(kMinPollIntervalSec,
+    mpAppSettings->value(kPollingIntervalId).toDouble());
+  mHistory.traffic.setSampleInterval(pollInterval);
+  mHistory.connections.setSampleInterval(pollInterval);
+  mFolderSeries.setSampleInterval(pollInterval);
+}
+
+
+//------------------------------------------------------------------------------------//
+
+std::size_t StatsWidget::maxPlotPoints(const QCustomPlot* plot) const
+{
+  // two samples per horizontal pixel are as much as a line plot can show
+  return static_cast<std::size_t>((std::max)(plot->width(), 400)) * 2;
+}
+
+
+//------------------------------------------------------------------------------------//
+
+void StatsWidget::reserveGraphPoints(QCustomPlot* plot, const std::size_t maxPoints) const
+{
+  // the graphs keep a fixed ring of points, sized in powers of two so that
+  // it is only reallocated when the widget grows a lot; a ring too small
+  // would drop the oldest points of a slice
+  int capacity = 1024;
+  while (static_cast<std::size_t>(capacity) < maxPoints + 2 * kDecimationOversampling + 16)
+  {
+    capacity *= 2;
+  }
+  for (int graph = 0; graph < plot->graphCount(); ++graph)
+  {
+    plot->graph(graph)->data()->setCapacity(capacity);
+  }
+}
+
+
 //------------------------------------------------------------------------------------//
 
 void StatsWidget::addConnectionPoint(const std::uint16_t& numConn)
 {
   using namespace std::chrono;
-  std::unique_lock<std::mutex> lock(mDataGuard, std::try_to_lock);
-  if(!lock.owns_lock())
+  handOff({toPlotTime(system_clock::now()), {static_cast<float>(numConn), 0.f},
+    HistorySeries::connections, 0});
+}
+
+
+//------------------------------------------------------------------------------------//
+
+void StatsWidget::updateTrafficData(const TrafficData& traffData)
+{
+  handOff({toPlotTime(std::get<2>(traffData)),
+    {static_cast<float>(std::get<0>(traffData)),
+     static_cast<float>(std::get<1>(traffData))}, HistorySeries::traffic, 0});
+}
+
+
+//------------------------------------------------------------------------------------//
+
+void StatsWidget::updateFolderTraffic(const std::vector<TransferRate>& folders)
+{
+  // A folder keeps its slot, and so its colour, while it stays among the
+  // busiest; a slot only goes to another folder once its own dropped out.
+  // Slots are kept by folder id, the label is only for the legend. Not
+  // written to the history log, the folders are only known per session.
+  using namespace std::chrono;
+  const auto now = toPlotTime(system_clock::now());
+  const auto numTop = (std::min)(folders.size(), kNumFolderSlots);
+  std::array<bool, kNumFolderSlots> taken{};
+  std::array<QString, kNumFolderSlots> labels;
+  std::vector<std::size_t> newcomers;
+  StatsHistory<kNumFolderSlots + 1>::Values values{};
+  for (std::size_t idx = 0; idx < numTop; ++idx)
   {
-    return;
+    const auto slot = std::find(mFolderSlots.begin(), mFolderSlots.end(), folders[idx].key);
+    if (slot == mFolderSlots.end())
+    {
+      newcomers.push_back(idx);
+      continue;
+    }
+    const auto slotIdx = static_cast<std::size_t>(slot - mFolderSlots.begin());
+    taken[slotIdx] = true;
+    labels[slotIdx] = folders[idx].label;
+    values[slotIdx] = folders[idx].total();
+  }
+  for (const auto idx : newcomers)
+  {
+    const auto slotIdx = static_cast<std::size_t>(
+      std::find(taken.begin(), taken.end(), false) - taken.begin());
+    taken[slotIdx] = true;
+    mFolderSlots[slotIdx] = folders[idx].key;
+    labels[slotIdx] = folders[idx].label;
+    values[slotIdx] = folders[idx].total();
+  }
+  for (std::size_t idx = numTop; idx < folders.size(); ++idx)
+  {
+    values[kNumFolderSlots] += folders[idx].total();
+  }
+  // A slot that went straight from one folder to another drops to zero in
+  // between, so that the line of the old folder does not run into the new
+  // one; the column then keeps a label per folder it showed.
+  auto breakValues = values;
+  bool reassigned = false;
+  for (std::size_t slot = 0; slot < kNumFolderSlots; ++slot)
+  {
+    if (!taken[slot])
+    {
+      mFolderSlots[slot].clear();
+    }
+    auto& segments = mFolderSegments[slot];
+    if (!segments.empty() && segments.back().label == labels[slot])
+    {
+      continue;
+    }
+    if (!segments.empty() && !segments.back().label.isEmpty() && !labels[slot].isEmpty())
+    {
+      breakValues[slot] = 0;
+      reassigned = true;
+    }
+    segments.push_back({now, labels[slot]});
+  }
+  if (reassigned && !mFolderSeries.empty() && now > mFolderSeries.lastTime())
+  {
+    mFolderSeries.push((mFolderSeries.lastTime() + now) / 2, breakValues);
   }
-  mConnectionPoints.emplace_back(std::make_tuple(numConn, system_clock::now()));
-  cleanupTimeData(mConnectionPoints, std::chrono::minutes{mMaxTimeInPlotMins});
-  zeroMissingTimeData(mConnectionPoints);
+  mFolderSeries.push(now, values);
+  // segments that ended before the oldest retained sample are no longer shown
+  const auto first = mFolderSeries.firstTime();
+  for (auto& segments : mFolderSegments)
+  {
+    auto end = segments.begin();
+    while (end + 1 < segments.end() && (end + 1)->start <= first)
+    {
+      ++end;
+    }
+    segments.erase(segments.begin(), end);
+  }
+  mFoldersDirty = true;
 }
 
 
 //------------------------------------------------------------------------------------//
 
-void StatsWidget::updateTrafficData(const TrafficData& traffData)
+QString StatsWidget::folderLabel(const std::size_t slot, const QCPRange& range) const
 {
-  std::unique_lock<std::mutex> lock(mDataGuard, std::try_to_lock);
-  if(!lock.owns_lock())
+  // the folders a column showed within the range, oldest first
+  const auto& segments = mFolderSegments[slot];
+  QStringList labels;
+  for (std::size_t idx = 0; idx < segments.size(); ++idx)
   {
-    return;
+    const auto end = idx + 1 < segments.size() ?
+      segments[idx + 1].start : std::numeric_limits<double>::infinity();
+    if (!segments[idx].label.isEmpty() && end > range.lower &&
+      segments[idx].start <= range.upper)
+    {
+      labels.append(segments[idx].label);
+    }
+  }
+  return labels.isEmpty() ? QString("-") : labels.join(" / ");
+}
+
+
+//------------------------------------------------------------------------------------//
+
+void StatsWidget::handOff(const HistoryRecord& record)
+{
+  // Samples wait for the next redraw or a queued drain, so a burst of polls
+  // is added to the history in one go. Nothing is dropped: if too many
+  // wait, the samples of a series are averaged into one.
+  if (mPendingSamples.size() < kMaxPendingSamples)
+  {
+    mPendingSamples.push_back(record);
+    ++mHandedOff;
+  }
+  else
+  {
+    auto& pending = mOverflow[static_cast<std::size_t>(record.series)];
+    if (pending.count == 0)
+    {
+      pending.record = record;
+    }
+    else
+    {
+      const float weight = 1.f / (pending.count + 1);
+      for (std::size_t idx = 0; idx < 2; ++idx)
+      {
+        pending.record.values[idx] +=
+          (record.values[idx] - pending.record.values[idx]) * weight;
+      }
+      pending.record.time = record.time;
+      ++mCoalesced;
+    }
+    ++pending.count;
+  }
+  if (!mDrainScheduled)
+  {
+    mDrainScheduled = true;
+    QMetaObject::invokeMethod(this, "drainSamples", Qt::QueuedConnection);
+  }
+}
+
+
+//------------------------------------------------------------------------------------//
+
+void StatsWidget::drainSamples()
+{
+  mDrainScheduled = false;
+  const auto take = [this](const HistoryRecord& record)
+  {
+    // while the log is replayed, the samples are added once it is done
+    if (mHistoryLoader.joinable())
+    {
+      mLoadBacklog.push_back(record);
+      return;
+    }
+    auto& dirty = record.series == HistorySeries::traffic ?
+      mTrafficDirty : mConnectionsDirty;
+    // a sample going back in time is dropped and not logged either
+    if (mHistory.add(record))
+    {
+      dirty = true;
+      mHistoryLog.append(record);
+    }
+  };
+  for (const auto& record : mPendingSamples)
+  {
+    take(record);
+  }
+  mPendingSamples.clear();
+  // the overflow samples are newer than all queued ones
+  for (auto& pending : mOverflow)
+  {
+    if (pending.count > 0)
+    {
+      take(pending.record);
+      pending.count = 0;
+    }
+  }
+}
+
+
+//------------------------------------------------------------------------------------//
+
+std::uint64_t StatsWidget::handedOffSamples() const
+{
+  return mHandedOff;
+}
+
+
+//------------------------------------------------------------------------------------//
+
+std::uint64_t StatsWidget::coalescedSamples() const
+{
+  return mCoalesced;
+}
+
+
+//------------------------------------------------------------------------------------//
+
+std::uint64_t StatsWidget::avoidedReplots() const
+{
+  return mAvoidedReplots;
+}
+
+
+//------------------------------------------------------------------------------------//
+
+std::uint64_t StatsWidget::scrolledFrames() const
+{
+  return mTrafficRasterizer.scrolledFrames() + mConnectionRasterizer.scrolledFrames();
+}
+
+
+//------------------------------------------------------------------------------------//
+
+std::uint64_t StatsWidget::droppedFrames() const
+{
+  return mTrafficRasterizer.droppedFrames() + mConnectionRasterizer.droppedFrames();
+}
+
+
+//------------------------------------------------------------------------------------//
+
+bool StatsWidget::SampleHistory::add(const HistoryRecord& record)
+{
+  switch (record.series)
+  {
+    case HistorySeries::traffic:
+    {
+      StatsHistory<2>::Values values;
+      values[kInColumn] = record.values[0];
+      values[kOutColumn] = record.values[1];
+      if (!traffic.push(record.time, values))
+      {
+        return false;
+      }
+      inPercentiles.add(record.time, record.values[0]);
+      outPercentiles.add(record.time, record.values[1]);
+      return true;
+    }
+    case HistorySeries::connections:
+      if (!connections.push(record.time, {{record.values[0]}}))
+      {
+        return false;
+      }
+      connectionPercentiles.add(record.time, record.values[0]);
+      return true;
   }
-  mTrafficPoints.push_back(traffData);
-  cleanupTimeData(mTrafficPoints, std::chrono::minutes{mMaxTimeInPlotMins});
-  zeroMissingTimeData(mTrafficPoints);
+  return false;
 }
 
 
@@ -215,52 +762,64 @@ void StatsWidget::updateTrafficData(const TrafficData& traffData)
 
 void StatsWidget::updatePlot()
 {
-  std::unique_lock<std::mutex> lock(mDataGuard, std::try_to_lock);
-  if(!lock.owns_lock())
+  drainSamples();
+  mRedrawTimer.setInterval(redrawInterval());
+  if (!isPlotExposed())
   {
+    // nobody would see it, the dirty flags keep the work for later; only
+    // plots with new data would have been redrawn
+    mAvoidedReplots += (mTrafficDirty ? 1 : 0) + (mConnectionsDirty ? 1 : 0) +
+      (mFoldersDirty ? 1 : 0);
+    return;
+  }
+  if (mTrafficDirty || mConnectionsDirty)
+  {
+    updatePercentiles();
+  }
+  if (mBrowsing)
+  {
+    // the plots stay where the user moved them, the dirty flags bring them
+    // up to date once browsing ends
     return;
   }
   updateTrafficPlot();
   updateConnectionsPlot();
+  updateFoldersPlot();
 }
 
 
 //------------------------------------------------------------------------------------//
 
-void StatsWidget::updateConnectionsPlot()
+void StatsWidget::updatePercentiles()
 {
-  const auto numPoints = static_cast<double>(mConnectionPoints.size());
-  QVector<double> connections(numPoints), time(numPoints);
+  mpPercentileLabel->setText(
+    "<table cellspacing='4'>"
+    "<tr><th align='left'>p50 / p95 / p99</th>"
+    "<th>Last hour</th><th>Last day</th><th>Last week</th></tr>" +
+    formatPercentiles("In (kb/s)", mHistory.inPercentiles, 1) +
+    formatPercentiles("Out (kb/s)", mHistory.outPercentiles, 1) +
+    formatPercentiles("Connections", mHistory.connectionPercentiles, 0) +
+    "</table>");
+}
 
-  using namespace std::chrono;
 
-  const auto& maxTime = duration_cast<seconds>(std::get<1>(
-    mConnectionPoints.back()).time_since_epoch()).count();
-  const auto& minTime = duration_cast<seconds>(std::get<1>(
-    mConnectionPoints.front()).time_since_epoch()).count();
+//------------------------------------------------------------------------------------//
 
-  auto idx = 0;
-  for (auto& connPoint : mConnectionPoints)
+void StatsWidget::updateConnectionsPlot()
+{
+  if (!mConnectionsDirty)
   {
-    const auto& timePoint =
-      duration_cast<seconds>(std::get<1>(connPoint).time_since_epoch()).count();
-    connections[idx] = std::get<0>(connPoint);
-    time[idx] = static_cast<double>(timePoint);
-    idx++;
+    ++mAvoidedReplots;
+    return;
   }
-
-  mpConnectionPlot->graph(0)->setData(time, connections);
-
-  auto cmp = [](const ConnectionPlotData& lhs, const ConnectionPlotData& rhs)
+  mConnectionsDirty = false;
+  if (!feedPlot(mpConnectionPlot, mHistory.connections, mConnectionFeed, {0}))
   {
-    return std::get<0>(lhs) < std::get<0>(rhs);
-  };
-  const auto& maxConns = std::max_element(
-    mConnectionPoints.begin(), mConnectionPoints.end(), cmp);
-  mpConnectionPlot->yAxis->setRange(0, std::get<0>(*maxConns));
-  mpConnectionPlot->xAxis->setRange(minTime, maxTime);
-
-  mpConnectionPlot->replot();
+    return;
+  }
+  mpConnectionPlot->yAxis->setRange(mConnectionFeed.minValue(),
+    mConnectionFeed.maxValue());
+  requestFrame(mpConnectionPlot, mConnectionFeed, mConnectionRasterizer);
 }
 
 
@@ -268,109 +827,268 @@ void StatsWidget::updateConnectionsPlot()
 
 void StatsWidget::updateTrafficPlot()
 {
-  const auto numPoints = static_cast<double>(mTrafficPoints.size());
-  QVector<double> inTraff(numPoints);
-  QVector<double> outTraff(numPoints), time(numPoints);
+  if (!mTrafficDirty)
+  {
+    ++mAvoidedReplots;
+    return;
+  }
+  mTrafficDirty = false;
+  if (!feedPlot(mpCustomPlot, mHistory.traffic, mTrafficFeed, {kOutColumn, kInColumn}))
+  {
+    return;
+  }
+  mpCustomPlot->yAxis->setRange(mTrafficFeed.minValue(), mTrafficFeed.maxValue());
+  requestFrame(mpCustomPlot, mTrafficFeed, mTrafficRasterizer);
+}
 
-  using namespace std::chrono;
 
-  const auto& maxTime = duration_cast<seconds>(std::get<2>(
-    mTrafficPoints.back()).time_since_epoch()).count();
-  const auto& minTime = duration_cast<seconds>(std::get<2>(
-    mTrafficPoints.front()).time_since_epoch()).count();
+//------------------------------------------------------------------------------------//
 
-  auto idx = 0;
-  for (auto& traffPoint : mTrafficPoints)
+void StatsWidget::updateFoldersPlot()
+{
+  if (!mFoldersDirty)
+  {
+    ++mAvoidedReplots;
+    return;
+  }
+  mFoldersDirty = false;
+  if (!mFolderSeries.empty())
   {
-    const auto& timePoint =
-      duration_cast<seconds>(std::get<2>(traffPoint).time_since_epoch()).count();
-    inTraff[idx] = std::get<0>(traffPoint);
-    outTraff[idx] = std::get<1>(traffPoint);
-    time[idx] = static_cast<double>(timePoint);
-    idx++;
+    const auto last = mFolderSeries.lastTime();
+    loadFolderSlice(QCPRange(last - mMaxTimeInPlotMins * 60.0, last));
   }
+}
 
-  mpCustomPlot->graph(0)->setData(time, outTraff);
-  mpCustomPlot->graph(1)->setData(time, inTraff);
 
-  const auto& maxOutTraffic = utilities::find_max_tuple_value<1>(mTrafficPoints);
-  const auto& maxInTraffic = utilities::find_max_tuple_value<0>(mTrafficPoints);
-  const auto maxTraffic = (std::max)(maxOutTraffic, maxInTraffic);
+//------------------------------------------------------------------------------------//
+
+void StatsWidget::loadFolderSlice(const QCPRange& range)
+{
+  // every graph holds the sum of the slots up to its own, the fill between
+  // neighbours is then the share of one slot; the slice is not decimated so
+  // the points of all graphs stay at the same times
+  setKeyRange(mpFolderPlot, range);
+  for (std::size_t slot = 0; slot < kNumFolderSlots; ++slot)
+  {
+    mpFolderPlot->graph(static_cast<int>(slot))->setName(folderLabel(slot, range));
+  }
+  if (mFolderSeries.empty())
+  {
+    return;
+  }
+  const auto slice = mFolderSeries.slice(range.lower, range.upper,
+    maxPlotPoints(mpFolderPlot));
+  const auto count = static_cast<int>(slice.last - slice.first);
+  mPlotTime.resize(count);
+  mFeedValues.resize(count);
+  mPlotValues.fill(0, count);
+  mFolderSeries.copyTimes(slice.tier, mPlotTime.begin(), slice.first, slice.last);
+  for (std::size_t col = 0; col <= kNumFolderSlots; ++col)
+  {
+    mFolderSeries.copyColumn(slice.tier, col, kAvg, mFeedValues.begin(),
+      slice.first, slice.last);
+    for (int idx = 0; idx < count; ++idx)
+    {
+      mPlotValues[idx] += mFeedValues[idx];
+    }
+    mpFolderPlot->graph(static_cast<int>(col))->setData(mPlotTime, mPlotValues, true);
+  }
+  const auto maxValue = count > 0 ?
+    *std::max_element(mPlotValues.begin(), mPlotValues.end()) : 0.0;
+  mpFolderPlot->yAxis->setRange(0, (std::max)(maxValue, 1.0));
+  mpFolderPlot->replot(QCustomPlot::rpQueuedReplot);
+}
 
-  mpCustomPlot->yAxis->setRange(0, maxTraffic);
-  mpCustomPlot->xAxis->setRange(minTime, maxTime);
 
-  mpCustomPlot->replot();
+//------------------------------------------------------------------------------------//
+
+void StatsWidget::requestFrame(QCustomPlot* plot, const PlotFeed& feed,
+  PlotRasterizer& rasterizer)
+{
+  // the plot is only redrawn once the frame is ready, see showFrame
+  rasterizer.submit(snapshotGraphs(plot, feed.firstChangedTime));
 }
 
 
 //------------------------------------------------------------------------------------//
 
-template<typename Container, typename Duration>
-void StatsWidget::cleanupTimeData(Container& vec, const Duration& dur)
+void StatsWidget::showFrame(QCustomPlot* plot, PlotFrameLayerable* frameLayerable,
+  const PlotFrame& frame)
 {
-  using namespace std::chrono;
-  using TimeValueType = std::chrono::time_point<std::chrono::system_clock>;
-  using ContainerValueType = typename Container::value_type;
-  const auto TimeValueTypePosition =
-    utilities::Index<TimeValueType, ContainerValueType>::value;
-
-  const auto& maxTime = std::get<TimeValueTypePosition>(vec.back());
-  const auto minTime = maxTime - dur;
-  const auto timeCmp = [](const ContainerValueType& obj, const TimeValueType& time)
+  // Only the frame is blitted. If the range it was drawn with moved, grid
+  // and axes are redrawn on their own buffers for the new range; only when
+  // the new tick labels change the margins, the whole plot is replotted.
+  // While browsing, the axes follow the user and have been redrawn already.
+  const bool moved = !mBrowsing && (frameLayerable->frame().keyRange != frame.keyRange ||
+    frameLayerable->frame().valueRange != frame.valueRange);
+  if (!mBrowsing)
+  {
+    setKeyRange(plot, frame.keyRange);
+    plot->yAxis->setRange(frame.valueRange);
+  }
+  frameLayerable->setFrame(frame);
+  if (moved)
+  {
+    // the layout phases of QCustomPlot::replot, they set up the new ticks
+    const auto axisRect = plot->axisRect()->rect();
+    const auto layout = plot->plotLayout();
+    layout->update(QCPLayoutElement::upPreparation);
+    layout->update(QCPLayoutElement::upMargins);
+    layout->update(QCPLayoutElement::upLayout);
+    if (plot->axisRect()->rect() != axisRect)
     {
-      // MSVC2013 doesnt accept the capture
-      const auto pos = utilities::Index<TimeValueType, ContainerValueType>::value;
-      return std::get<pos>(obj) < time;
-    };
-  const auto endExpired = std::lower_bound(
-    std::begin(vec), std::end(vec), minTime, timeCmp);
-  vec.erase(std::begin(vec), endExpired);
+      plot->replot();
+      return;
+    }
+    plot->layer("grid")->replot();
+    plot->layer("axes")->replot();
+  }
+  plot->layer(kStripLayerName)->replot();
 }
 
 
 //------------------------------------------------------------------------------------//
 
-template<typename Container>
-void StatsWidget::zeroMissingTimeData(Container &vec)
+void StatsWidget::updateRepaintOverlay(QCustomPlot* plot, QCPItemText* overlay)
 {
-  using namespace std::chrono;
-  using TimeValueType = std::chrono::time_point<std::chrono::system_clock>;
-  using ContainerValueType = typename Container::value_type;
-  const auto TimeValueTypePosition =
-    utilities::Index<TimeValueType, ContainerValueType>::value;
-
-  const auto maxTimeDistance = seconds(kMaxSecBeforeZero);
-  auto timeCmp = [&maxTimeDistance]
-    (const ContainerValueType& lhs, const ContainerValueType& rhs)
+  if (overlay == nullptr)
+  {
+    return;
+  }
+  overlay->setText(repaintCounts(plot));
+  plot->layer("overlay")->replot();
+}
+
+
+//------------------------------------------------------------------------------------//
+
+template<typename Series>
+bool StatsWidget::feedPlot(QCustomPlot* plot, const Series& series, PlotFeed& feed,
+  const std::vector<std::size_t>& graphColumns)
+{
+  // Only samples newer than the last closed one are handed to the graphs,
+  // already sorted, and expired ones are cut off the front. A full reload
+  // is only needed when the visible range switches to another tier or the
+  // plot width changes the decimation buckets.
+  if (series.empty())
+  {
+    return false;
+  }
+  const auto span = mMaxTimeInPlotMins * 60.0;
+  const auto from = series.lastTime() - span;
+  const auto target = maxPlotPoints(plot);
+  // a tier up to kDecimationOversampling times finer than the plot can show
+  // is reduced to the target with LTTB, which keeps the spikes an average
+  // over a coarser tier would flatten
+  const auto tier = series.selectTier(from, target * kDecimationOversampling);
+  const auto bucketWidth = span / target;
+  std::size_t first = series.lowerBound(tier, from);
+  const auto numGraphs = graphColumns.size();
+  reserveGraphPoints(plot, target);
+  feed.extrema.resize(numGraphs);
+  feed.decimators.resize(numGraphs);
+  feed.lastSettledTime.resize(numGraphs);
+  feed.tailMin.assign(numGraphs, std::numeric_limits<double>::infinity());
+  feed.tailMax.assign(numGraphs, -std::numeric_limits<double>::infinity());
+  if (tier != feed.tier || bucketWidth != feed.bucketWidth)
+  {
+    for (std::size_t graph = 0; graph < numGraphs; ++graph)
     {
-      const auto pos =
-        utilities::Index<TimeValueType, ContainerValueType>::value;
-      return duration_cast<seconds>(
-        std::get<pos>(rhs) - std::get<pos>(lhs)) > maxTimeDistance;
-    };
+      plot->graph(static_cast<int>(graph))->data()->clear();
+      feed.extrema[graph].clear();
+      feed.decimators[graph].reset(bucketWidth);
+      feed.lastSettledTime[graph] = 0;
+    }
+    feed.tier = tier;
+    feed.bucketWidth = bucketWidth;
+    feed.firstChangedTime = -std::numeric_limits<double>::infinity();
+  }
+  else
+  {
+    // the undecided tail and the open bucket are replaced on every redraw
+    first = (std::max)(first, series.lowerBound(tier,
+      std::nextafter(feed.lastClosedTime, feed.lastClosedTime + 1)));
+    feed.firstChangedTime = *std::min_element(feed.lastSettledTime.begin(),
+      feed.lastSettledTime.end());
+    for (std::size_t graph = 0; graph < numGraphs; ++graph)
+    {
+      const auto data = plot->graph(static_cast<int>(graph))->data();
+      data->removeAfter(feed.lastSettledTime[graph]);
+      // the last point before the span is kept, the line from it enters the plot
+      if (!data->isEmpty())
+      {
+        data->removeBefore(data->findBegin(from)->key);
+      }
+      feed.extrema[graph].expireBefore(from);
+    }
+  }
 
-  const auto itDist = std::adjacent_find(vec.begin(), vec.end(), timeCmp);
-  if (itDist == vec.end())
+  const auto closed = series.closedSize(tier);
+  const auto numPoints = static_cast<int>(series.size(tier) - first);
+  mFeedTime.resize((std::max)(numPoints, 0));
+  mFeedValues.resize(mFeedTime.size());
+  series.copyTimes(tier, mFeedTime.begin(), first);
+  for (std::size_t graph = 0; graph < numGraphs; ++graph)
   {
-    return;
+    auto& decimator = feed.decimators[graph];
+    // the bucket maxima of an aggregate tier, as in loadHistorySlice
+    series.copyColumn(tier, graphColumns[graph], kMax, mFeedValues.begin(), first);
+    mPlotTime.clear();
+    mPlotValues.clear();
+    int idx = 0;
+    for (; idx < numPoints && first + idx < closed; ++idx)
+    {
+      decimator.push(mFeedTime[idx], mFeedValues[idx], mPlotTime, mPlotValues);
+    }
+    for (int settled = 0; settled < mPlotTime.size(); ++settled)
+    {
+      feed.extrema[graph].push(mPlotTime[settled], mPlotValues[settled]);
+    }
+    if (!mPlotTime.isEmpty())
+    {
+      feed.lastSettledTime[graph] = mPlotTime.last();
+    }
+    const auto tailBegin = mPlotTime.size();
+    decimator.pending(mPlotTime, mPlotValues);
+    for (; idx < numPoints; ++idx)
+    {
+      mPlotTime.push_back(mFeedTime[idx]);
+      mPlotValues.push_back(mFeedValues[idx]);
+    }
+    for (int tail = tailBegin; tail < mPlotValues.size(); ++tail)
+    {
+      feed.tailMin[graph] = (std::min)(feed.tailMin[graph], mPlotValues[tail]);
+      feed.tailMax[graph] = (std::max)(feed.tailMax[graph], mPlotValues[tail]);
+    }
+    plot->graph(static_cast<int>(graph))->addData(mPlotTime, mPlotValues, true);
   }
-  const auto itDistEnd = std::next(itDist, 1);
-  assert(itDistEnd != vec.end());
-  const auto& timePointStart = std::get<TimeValueTypePosition>(*itDist);
-  const auto& timePointEnd = std::get<TimeValueTypePosition>(*itDistEnd);
-  const auto newTimeStart = timePointStart + seconds(kMaxSecBeforeZero/2);
-  const auto newTimeEnd = timePointEnd - seconds(kMaxSecBeforeZero/2);
-
-  auto newStartElement = ContainerValueType();
-  auto newEndElement = ContainerValueType();
-  std::get<TimeValueTypePosition>(newStartElement) = newTimeStart;
-  std::get<TimeValueTypePosition>(newEndElement) = newTimeEnd;
-  const std::vector<ContainerValueType> newVec{newStartElement, newEndElement};
-  vec.insert(itDistEnd, newVec.begin(), newVec.end());
-  zeroMissingTimeData(vec);
+  if (closed > 0)
+  {
+    feed.lastClosedTime = series.time(tier, closed - 1);
+  }
+
+  const auto data = plot->graph(0)->data();
+  if (data->isEmpty())
+  {
+    return false;
+  }
+  // once the history fills the span, the range moves on in whole pixels so
+  // the plot can be scrolled instead of redrawn
+  const auto pixels = plot->axisRect()->width();
+  if (series.frontTime(tier) <= from && pixels > 0)
+  {
+    const auto secondsPerPixel = span / pixels;
+    const auto upper = std::ceil(series.lastTime() / secondsPerPixel) * secondsPerPixel;
+    setKeyRange(plot, QCPRange(upper - span, upper));
+  }
+  else
+  {
+    setKeyRange(plot, QCPRange(data->constBegin()->key, (data->constEnd() - 1)->key));
+  }
+  return true;
 }
 
+
 //------------------------------------------------------------------------------------//
 //------------------------------------------------------------------------------------//
 
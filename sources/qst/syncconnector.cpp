@@ -21,6 +21,7 @@
 #include <QObject>
 #include <QMessageBox>
 #include <QStyleFactory>
+#include <QUrlQuery>
 #include <cmath>
 #include <iostream>
 #include <qst/platforms.hpp>
@@ -82,7 +83,7 @@ void SyncConnector::testUrlAvailability()
   request.setRawHeader(QByteArray("X-API-Key"), headerByte);
   mpNetwork->clearAccessCache();
   QNetworkReply *reply = mpNetwork->get(request);
-  requestMap[reply] = kRequestMethod::urlTested;
+  trackReply(reply, kRequestMethod::urlTested);
   if (mpSyncWebView != nullptr)
   {
     mpSyncWebView->updateConnection(mCurrentUrl, mAuthentication);
@@ -132,7 +133,8 @@ void SyncConnector::urlTested(QNetworkReply* reply)
   else
   {
     ConnectionState connectionInfo =
-      api::APIHandlerFactory<QNetworkReply>().getConnectionVersionInfo(reply);
+      api::APIHandlerFactory<QNetworkReply>().getConnectionVersionInfo(reply,
+        takeReplyData(reply));
 
     int versionNumber = getCurrentVersion(connectionInfo.first);
     if (mAPIHandler == nullptr || mAPIHandler->version != versionNumber)
@@ -142,6 +144,8 @@ void SyncConnector::urlTested(QNetworkReply* reply)
           api::APIHandlerFactory<QNetworkReply>().getAPIForVersion(versionNumber));
     }
 
+    mTransferAttribution.restartEventStream();
+    mSyncCompletion.clear();
     mConnectionStateCallback(connectionInfo);
     mpConnectionAvailabilityTimer->stop();
     mpConnectionHealthTimer->start(mConnectionHealthTime);
@@ -161,16 +165,74 @@ void SyncConnector::checkConnectionHealth()
   QByteArray headerByte(mAPIKey.toStdString().c_str(), mAPIKey.size());
   healthRequest.setRawHeader(QByteArray("X-API-Key"), headerByte);
   QNetworkReply *reply = mpNetwork->get(healthRequest);
-  requestMap[reply] = kRequestMethod::connectionHealth;
+  trackReply(reply, kRequestMethod::connectionHealth);
 
   QUrl lastSyncedListURL = mCurrentUrl;
   lastSyncedListURL.setPath(tr("/rest/stats/folder"));
   QNetworkRequest lastSyncedRequest(lastSyncedListURL);
   lastSyncedRequest.setRawHeader(QByteArray("X-API-Key"), headerByte);
   QNetworkReply *lastSyncreply = mpNetwork->get(lastSyncedRequest);
-  requestMap[lastSyncreply] = kRequestMethod::getLastSyncedFiles;
+  trackReply(lastSyncreply, kRequestMethod::getLastSyncedFiles);
 
   getCurrentConfig();
+  if (mpEventsReply == nullptr)
+  {
+    requestEvents();
+  }
+  requestFileSizes();
+}
+
+
+//------------------------------------------------------------------------------------//
+
+void SyncConnector::requestEvents()
+{
+  // Syncthing holds the request until events arrive, each one is handed to
+  // the attribution as soon as it is parsed
+  QUrl requestUrl = mCurrentUrl;
+  requestUrl.setPath(tr("/rest/events"));
+  QUrlQuery query;
+  query.addQueryItem("since", QString::number(mTransferAttribution.lastEventId()));
+  query.addQueryItem("events",
+    "ItemStarted,ItemFinished,DownloadProgress,RemoteDownloadProgress,FolderSummary");
+  requestUrl.setQuery(query);
+  QNetworkRequest request(requestUrl);
+  QByteArray headerByte(mAPIKey.toStdString().c_str(), mAPIKey.size());
+  request.setRawHeader(QByteArray("X-API-Key"), headerByte);
+  mpEventsReply = mpNetwork->get(request);
+  trackReply(mpEventsReply, kRequestMethod::events);
+  mReplyReaders[mpEventsReply]->setElementCallback([this](const QJsonValue& event)
+  {
+    const auto object = event.toObject();
+    mTransferAttribution.processEvent(object, std::chrono::steady_clock::now());
+    mSyncCompletion.processEvent(object);
+  });
+}
+
+
+//------------------------------------------------------------------------------------//
+
+void SyncConnector::requestFileSizes()
+{
+  // uploads are reported in blocks, their size in bytes depends on the size
+  // of the file; a few lookups per poll are enough for the files in flight
+  static const std::size_t kMaxLookupsPerPoll = 8;
+  QByteArray headerByte(mAPIKey.toStdString().c_str(), mAPIKey.size());
+  for (const auto& file : mTransferAttribution.unknownFiles(kMaxLookupsPerPoll))
+  {
+    QUrl requestUrl = mCurrentUrl;
+    requestUrl.setPath(tr("/rest/db/file"));
+    QUrlQuery query;
+    query.addQueryItem("folder", file.first);
+    query.addQueryItem("file", file.second);
+    requestUrl.setQuery(query);
+    QNetworkRequest request(requestUrl);
+    request.setRawHeader(QByteArray("X-API-Key"), headerByte);
+    QNetworkReply *reply = mpNetwork->get(request);
+    reply->setProperty("folder", file.first);
+    reply->setProperty("file", file.second);
+    trackReply(reply, kRequestMethod::fileInfo);
+  }
 }
 
 
@@ -184,7 +246,52 @@ void SyncConnector::getCurrentConfig()
   QByteArray headerByte(mAPIKey.toStdString().c_str(), mAPIKey.size());
   request.setRawHeader(QByteArray("X-API-Key"), headerByte);
   QNetworkReply *reply = mpNetwork->get(request);
-  requestMap[reply] = kRequestMethod::getCurrentConfig;
+  trackReply(reply, kRequestMethod::getCurrentConfig);
+}
+
+
+//------------------------------------------------------------------------------------//
+
+void SyncConnector::trackReply(QNetworkReply *reply, const kRequestMethod method)
+{
+  requestMap[reply] = method;
+  mReplyReaders[reply] = std::make_shared<api::JsonStreamReader>();
+  connect(reply, &QNetworkReply::readyRead, this, [this, reply]
+  {
+    replyDataAvailable(reply);
+  });
+}
+
+
+//------------------------------------------------------------------------------------//
+
+void SyncConnector::replyDataAvailable(QNetworkReply *reply)
+{
+  const auto reader = mReplyReaders.value(reply);
+  if (reader == nullptr)
+  {
+    return;
+  }
+  if (reader->bufferedBytes() == 0)
+  {
+    reader->reserve(reply->header(QNetworkRequest::ContentLengthHeader).toLongLong());
+  }
+  reader->feed(reply->readAll());
+}
+
+
+//------------------------------------------------------------------------------------//
+
+auto SyncConnector::takeReplyData(QNetworkReply *reply) -> QJsonObject
+{
+  const auto reader = mReplyReaders.take(reply);
+  if (reader == nullptr || reply->error() != QNetworkReply::NoError)
+  {
+    return QJsonObject();
+  }
+  // pick up whatever arrived after the last readyRead
+  reader->feed(reply->readAll());
+  return reader->hasError() ? QJsonObject() : reader->object();
 }
 
 
@@ -208,11 +315,18 @@ void SyncConnector::netRequestfinished(QNetworkReply* reply)
     case kRequestMethod::getLastSyncedFiles:
       lastSyncedFilesReceived(reply);
       break;
+    case kRequestMethod::events:
+      eventsReceived(reply);
+      break;
+    case kRequestMethod::fileInfo:
+      fileInfoReceived(reply);
+      break;
     case kRequestMethod::shutdownRequested:
       shutdownProcessPosted(reply);
       break;
   }
   requestMap.remove(reply);
+  mReplyReaders.remove(reply);
 }
 
 
@@ -221,19 +335,18 @@ void SyncConnector::netRequestfinished(QNetworkReply* reply)
 void SyncConnector::connectionHealthReceived(QNetworkReply* reply)
 {
   ignoreSslErrors(reply);
-  QByteArray replyData;
-  if (reply->error() == QNetworkReply::NoError)
-  {
-    replyData = reply->readAll();
-  }
-  else if (reply->error() == QNetworkReply::UnknownNetworkError)
+  const QJsonObject replyData = takeReplyData(reply);
+  if (reply->error() == QNetworkReply::UnknownNetworkError)
   {
     resetNetworkAccessManager();
   }
   auto result = mAPIHandler->getConnections(replyData);
   auto traffic = mAPIHandler->getCurrentTraffic(replyData);
+  mTrafficStatistics = replyData.isEmpty() ?
+    stats::TrafficStatistics() : mAPIHandler->getTrafficStatistics();
 
-  emit(onNetworkActivityChanged(std::get<0>(traffic) + std::get<1>(traffic) > kNetworkNoiseFloor));
+  emit(onNetworkActivityChanged(mTrafficStatistics.first.smoothed +
+    mTrafficStatistics.second.smoothed > kNetworkNoiseFloor));
   emit(onConnectionHealthChanged({result, traffic}));
 
   reply->deleteLater();
@@ -264,12 +377,17 @@ void SyncConnector::resetNetworkAccessManager()
 void SyncConnector::currentConfigReceived(QNetworkReply *reply)
 {
   ignoreSslErrors(reply);
-  QByteArray replyData;
+  const QJsonObject replyData = takeReplyData(reply);
+  mFolders = mAPIHandler->getCurrentFolderList(replyData);
   if (reply->error() == QNetworkReply::NoError)
   {
-    replyData = reply->readAll();
+    QSet<QString> folderIds;
+    for (const auto& folder : mFolders)
+    {
+      folderIds.insert(folder.first);
+    }
+    mSyncCompletion.retainFolders(folderIds);
   }
-  mFolders = mAPIHandler->getCurrentFolderList(replyData);
   reply->deleteLater();
 }
 
@@ -278,24 +396,88 @@ void SyncConnector::currentConfigReceived(QNetworkReply *reply)
 
 void SyncConnector::lastSyncedFilesReceived(QNetworkReply *reply)
 {
-  QByteArray replyData;
-  if (reply->error() == QNetworkReply::NoError)
+  const QJsonObject replyData = takeReplyData(reply);
+  mLastSyncedFiles = mAPIHandler->getLastSyncedFiles(replyData);
+  reply->deleteLater();
+}
+
+
+//------------------------------------------------------------------------------------//
+
+void SyncConnector::eventsReceived(QNetworkReply *reply)
+{
+  const bool failed = reply->error() != QNetworkReply::NoError;
+  // parses the events that arrived after the last readyRead
+  takeReplyData(reply);
+  reply->deleteLater();
+  mpEventsReply = nullptr;
+  if (!failed)
   {
-    replyData = reply->readAll();
+    mTransferAttribution.finishBatch();
+    requestEvents();
   }
-  mLastSyncedFiles = mAPIHandler->getLastSyncedFiles(replyData);
+  else
+  {
+    // Syncthing may have restarted and numbers its events from 1 again, so
+    // the health check picks the stream up from the start; the first batch
+    // only rebuilds the state, see TransferAttribution::restartEventStream
+    mTransferAttribution.restartEventStream();
+    mSyncCompletion.clear();
+  }
+}
+
+
+//------------------------------------------------------------------------------------//
+
+void SyncConnector::fileInfoReceived(QNetworkReply *reply)
+{
+  // a file that cannot be looked up is counted with the smallest block size
+  const auto global = takeReplyData(reply)["global"].toObject();
+  mTransferAttribution.setFileSize(reply->property("folder").toString(),
+    reply->property("file").toString(), global["size"].toDouble(),
+    global["numBlocks"].toDouble(), std::chrono::steady_clock::now());
   reply->deleteLater();
 }
 
 
 //------------------------------------------------------------------------------------//
 
-LastSyncedFileList SyncConnector::getLastSyncedFiles()
+const LastSyncedFileList& SyncConnector::getLastSyncedFiles()
 {
   return mLastSyncedFiles;
 }
 
 
+//------------------------------------------------------------------------------------//
+
+stats::TrafficStatistics SyncConnector::getTrafficStatistics()
+{
+  return mTrafficStatistics;
+}
+
+
+//------------------------------------------------------------------------------------//
+
+std::vector<stats::TransferRate> SyncConnector::getFolderTraffic(const std::size_t count)
+{
+  auto folders = mTransferAttribution.topFolders(count, std::chrono::steady_clock::now());
+  for (auto& folder : folders)
+  {
+    folder.inRate /= kBytesToKilobytes;
+    folder.outRate /= kBytesToKilobytes;
+  }
+  return folders;
+}
+
+
+//------------------------------------------------------------------------------------//
+
+double SyncConnector::getSyncCompletion()
+{
+  return mSyncCompletion.completion();
+}
+
+
 //------------------------------------------------------------------------------------//
 
 void SyncConnector::pauseSyncthing(bool paused)
@@ -353,7 +535,7 @@ void SyncConnector::shutdownProcessPosted(QNetworkReply *reply)
 
 //------------------------------------------------------------------------------------//
 
-auto SyncConnector::getFolders() -> std::list<FolderNameFullPath>
+auto SyncConnector::getFolders() -> const std::list<FolderNameFullPath>&
 {
   return mFolders;
 }
@@ -37,6 +37,7 @@
 #include <QTextEdit>
 #include <QVBoxLayout>
 #include <QMessageBox>
+#include <algorithm>
 #include <functional>
 #include <iostream>
 #include <map>
@@ -50,6 +51,29 @@ static const std::list<std::pair<std::string, std::string>> kIconSet(
 static const std::list<std::string> kAnimatedIconSet(
   {":/images/syncthingBlueAnim.gif",
   ":/images/syncthingBlackAnim.gif"});
+static QStringList iconSetPaths()
+{
+  QStringList paths;
+  for (const auto& iconSet : kIconSet)
+  {
+    paths << iconSet.first.c_str() << iconSet.second.c_str();
+  }
+  return paths;
+}
+static QStringList animatedIconSetPaths()
+{
+  QStringList paths;
+  for (const auto& path : kAnimatedIconSet)
+  {
+    paths << path.c_str();
+  }
+  return paths;
+}
+//! The icon only stops spinning after this long without network activity
+static const qint64 kAnimationHoldMs = 5000;
+//! Folders listed in the tray menu, the stats plot sums up more of them
+static const int kNumTopFolders = 5;
+static const std::size_t kNumAttributedFolders = 32;
 //! [0]
 //------------------------------------------------------------------------------------//
 //------------------------------------------------------------------------------------//
@@ -61,7 +85,7 @@ Window::Window()
       std::bind(&Window::onUpdateConnState, this, std::placeholders::_1), mpAppSettings))
   , mpProcessMonitor(new qst::monitor::ProcessMonitor(mpSyncConnector, mpAppSettings))
   , mpStartupTab(new qst::settings::StartupTab(mpProcController, mpAppSettings))
-  , mpAnimatedIconMovie(new QMovie())
+  , mTrayIcons(iconSetPaths(), animatedIconSetPaths())
   , mUpdateNotifier(std::bind(&Window::onUpdateCheck, this, std::placeholders::_1),
       QString(QSYNCTHINGTRAY_VERSION), mpAppSettings)
 {
@@ -86,8 +110,8 @@ Window::Window()
       SLOT(animateIconBoxChanged(int)));
     connect(mpNotificationsIconBox, SIGNAL(stateChanged(int)), this,
       SLOT(notificationsIconBoxChanged(int)));
-    connect(mpAnimatedIconMovie.get(), SIGNAL(frameChanged(int)),
-      this, SLOT(onUpdateIcon()));
+    mAnimationTimer.setTimerType(Qt::CoarseTimer);
+    connect(&mAnimationTimer, SIGNAL(timeout()), this, SLOT(onUpdateIcon()));
     connect(mpWebViewZoomFactor, SIGNAL(valueChanged(double)), this,
       SLOT(webViewZoomFactorChanged(double)));
 
@@ -153,6 +177,27 @@ void Window::closeEvent(QCloseEvent *event)
 }
 
 
+//------------------------------------------------------------------------------------//
+
+bool Window::updateProgressOverlay(const double completion, const double inTraffic,
+  const double outTraffic)
+{
+  // quantized, so the icon is only composed again when the bar grows by a
+  // step or the direction changes
+  using Direction = qst::icons::TrayIconCache::Direction;
+  const int step = completion < 1.0 ?
+    static_cast<int>(completion * qst::icons::TrayIconCache::kProgressSteps) : -1;
+  const bool in = inTraffic > kNetworkNoiseFloor;
+  const bool out = outTraffic > kNetworkNoiseFloor;
+  const auto direction = in && out ? Direction::both :
+    in ? Direction::in : out ? Direction::out : Direction::none;
+  const bool changed = step != mProgressStep || direction != mTrafficDirection;
+  mProgressStep = step;
+  mTrafficDirection = direction;
+  return changed;
+}
+
+
 //------------------------------------------------------------------------------------//
 
 void Window::onUpdateConnState(const ConnectionState& result)
@@ -175,29 +220,24 @@ void Window::onUpdateConnState(const ConnectionState& result)
 
 void Window::setIcon(const int index, const bool isManualSet)
 {
-  // temporary workaround as setIcon seems to leak memory
+  // only set on a change, as setIcon seems to leak memory
   // https://bugreports.qt.io/browse/QTBUG-23658?jql=text%20~%20%22setIcon%20memory%22
   // https://bugreports.qt.io/browse/QTBUG-16113?jql=text%20~%20%22setIcon%20memory%22
+  // and the icons all come decoded from mTrayIcons
 
   if (index != mLastIconIndex || isManualSet)
   {
-    QIcon icon;
-    std::pair<std::string, std::string> iconSet = mIconMonochrome ?
-      kIconSet.back() : kIconSet.front();
-    switch(index)
-    {
-      case 0:
-        icon = QIcon(iconSet.first.c_str());
-        break;
-      case 1:
-        icon = QIcon(iconSet.second.c_str());
-        break;
-      default:
-        icon = QIcon(iconSet.second.c_str());
-        break;
-    }
-
-    if (mpAnimatedIconMovie->state() != QMovie::Running)
+    const auto& iconSet = mIconMonochrome ? kIconSet.back() : kIconSet.front();
+    const QString path = index == 0 ? iconSet.first.c_str() : iconSet.second.c_str();
+    // connected, the icon also shows the sync progress and the traffic
+    using Direction = qst::icons::TrayIconCache::Direction;
+    const bool showProgress = index == 0 &&
+      (mProgressStep >= 0 || mTrafficDirection != Direction::none);
+    const auto& icon = showProgress ?
+      mTrayIcons.progressIcon(path, mProgressStep, mTrafficDirection) :
+      mTrayIcons.icon(path);
+
+    if (!mAnimationTimer.isActive())
     {
       mpTrayIcon->setIcon(icon);
     }
@@ -259,8 +299,9 @@ void Window::updateConnectionHealth(const ConnectionStateData& state)
     mpConnectedState->setVisible(true);
     mpConnectedState->setText(tr("Connected"));
 
-    const auto inTraffic = std::get<0>(traffic);
-    const auto outTraffic = std::get<1>(traffic);
+    const auto trafficStats = mpSyncConnector->getTrafficStatistics();
+    const auto inTraffic = trafficStats.first.smoothed;
+    const auto outTraffic = trafficStats.second.smoothed;
     mpCurrentTrafficAction->setVisible(true);
     mpCurrentTrafficAction->setText(tr("Total: ")
       + trafficToString(inTraffic + outTraffic));
@@ -270,13 +311,19 @@ void Window::updateConnectionHealth(const ConnectionStateData& state)
     mpTrafficOutAction->setVisible(true);
     mpTrafficOutAction->setText(tr("Out: ") + trafficToString(outTraffic));
     mpShowWebViewAction->setDisabled(false);
+    mpTrayIcon->setToolTip(tr("Syncthing\n")
+      + tr("In: ") + trafficToString(trafficStats.first.avg)
+      + tr(" (max ") + trafficToString(trafficStats.first.max) + tr(")\n")
+      + tr("Out: ") + trafficToString(trafficStats.second.avg)
+      + tr(" (max ") + trafficToString(trafficStats.second.max) + tr(")"));
 
     if (mLastSyncedFiles != mpSyncConnector->getLastSyncedFiles())
     {
       mLastSyncedFiles = mpSyncConnector->getLastSyncedFiles();
       createLastSyncedMenu();
     }
-    setIcon(0);
+    setIcon(0, updateProgressOverlay(mpSyncConnector->getSyncCompletion(),
+      inTraffic, outTraffic));
     if (mLastConnectionState != 1)
     {
       showMessage("Connected", "Syncthing is running.");
@@ -284,6 +331,9 @@ void Window::updateConnectionHealth(const ConnectionStateData& state)
 
     mpStatsWidget->updateTrafficData(traffic);
     mpStatsWidget->addConnectionPoint(activeConnections.toInt());
+    const auto folderTraffic = labeledFolderTraffic();
+    mpStatsWidget->updateFolderTraffic(folderTraffic);
+    updateTopFoldersMenu(folderTraffic);
   }
   else
   {
@@ -429,35 +479,40 @@ void Window::messageClicked()
 
 //------------------------------------------------------------------------------------//
 
-void Window::folderClicked()
+void Window::folderClicked(QAction* action)
 {
-  QObject *obj = sender();
-  QAction * senderObject = static_cast<QAction*>(obj);
-  QString findFolder = senderObject->text();
+  // the action's data is the folder id, see createFoldersMenu
+  QString findFolder = action->data().toString();
   std::list<FolderNameFullPath>::iterator folder =
     std::find_if(mCurrentFoldersLocations.begin(), mCurrentFoldersLocations.end(),
       [&findFolder](FolderNameFullPath const& elem) {
-        return qst::utilities::getFullCleanFileName(elem.second) == findFolder;
+        return elem.first == findFolder;
       });
-  QDesktopServices::openUrl(QUrl::fromLocalFile(folder->second));
+  if (folder != mCurrentFoldersLocations.end())
+  {
+    QDesktopServices::openUrl(QUrl::fromLocalFile(folder->second));
+  }
 }
 
 
 //------------------------------------------------------------------------------------//
 
-void Window::syncedFileClicked()
+void Window::syncedFileClicked(QAction* action)
 {
   using namespace qst::utilities;
   using namespace qst::sysutils;
 
-  QObject *obj = sender();
-  QAction * senderObject = static_cast<QAction*>(obj);
-  QString findFile = senderObject->text();
+  // the action's data is the folder and file, see createLastSyncedMenu
+  QString findFile = action->data().toString();
   LastSyncedFileList::iterator fileIterator =
   std::find_if(mLastSyncedFiles.begin(), mLastSyncedFiles.end(),
                [&findFile](DateFolderFile const& elem) {
-                 return getCleanFileName(std::get<2>(elem)) == findFile;
+                 return syncedFileKey(elem) == findFile;
                });
+  if (fileIterator == mLastSyncedFiles.end())
+  {
+    return;
+  }
   
   // get full path to folder
   std::list<FolderNameFullPath>::iterator folder =
@@ -634,57 +689,81 @@ void Window::quit()
 
 void Window::createFoldersMenu()
 {
+  // only the folders that came, went or moved touch the menu
+  const auto& folders = mpSyncConnector->getFolders();
+  if (mCurrentFoldersLocations != folders)
+  {
+    mCurrentFoldersLocations = folders;
+    mpFolderMenuModel->update(mCurrentFoldersLocations);
+  }
+}
 
-  if (mCurrentFoldersLocations != mpSyncConnector->getFolders())
+
+//------------------------------------------------------------------------------------//
+
+auto Window::labeledFolderTraffic() -> std::vector<qst::stats::TransferRate>
+{
+  // the events only carry folder ids, the menus show the folder names;
+  // names need not be unique, so the ids stay the keys
+  using namespace qst::utilities;
+  auto folders = mpSyncConnector->getFolderTraffic(kNumAttributedFolders);
+  for (auto& folder : folders)
   {
-    mpFolderMenu->clear();
-    for (auto action : mCurrentFoldersActions)
-    {
-      action->deleteLater();
-    }
-    mCurrentFoldersActions.clear();
-    mCurrentFoldersLocations = mpSyncConnector->getFolders();
-    for (std::list<FolderNameFullPath>::iterator it=mCurrentFoldersLocations.begin();
-      it != mCurrentFoldersLocations.end(); ++it)
+    folder.label = folder.key;
+    const auto location = std::find_if(mCurrentFoldersLocations.begin(),
+      mCurrentFoldersLocations.end(), [&](const FolderNameFullPath& entry)
+      {
+        return entry.first == folder.key;
+      });
+    if (location != mCurrentFoldersLocations.end())
     {
-      using namespace qst::utilities;
-      QAction *aAction = new QAction(getFullCleanFileName(it->second), this);
-      connect(aAction, SIGNAL(triggered()), this, SLOT(folderClicked()));
-      mCurrentFoldersActions.push_back(aAction);
+      folder.label = getFullCleanFileName(location->second);
     }
-    mpFolderMenu->addActions(mCurrentFoldersActions);
   }
+  return folders;
 }
 
 
 //------------------------------------------------------------------------------------//
 
-void Window::createLastSyncedMenu()
+void Window::updateTopFoldersMenu(const std::vector<qst::stats::TransferRate>& folders)
 {
+  // a fixed set of actions, only their texts change with every poll
   using namespace qst::utilities;
-  if (mLastSyncedFiles.size() > 0)
+  for (int idx = 0; idx < mTopFoldersActions.size(); ++idx)
   {
-    mpLastSyncedMenu->clear();
-    for (auto action : mCurrentSyncedFilesActions)
+    const auto action = mTopFoldersActions[idx];
+    if (static_cast<std::size_t>(idx) < folders.size())
     {
-      action->deleteLater();
+      const auto& folder = folders[idx];
+      action->setText(folder.label + ": " + tr("In: ") + trafficToString(folder.inRate)
+        + " / " + tr("Out: ") + trafficToString(folder.outRate));
     }
-    mCurrentSyncedFilesActions.clear();
-    for (LastSyncedFileList::iterator it=mLastSyncedFiles.begin();
-         it != mLastSyncedFiles.end(); ++it)
+    else
     {
-      QAction *aAction = new QAction(getCleanFileName(std::get<2>(*it)), this);
-
-      // 4th item of tuple is file-erased-bool
-      aAction->setDisabled(std::get<3>(*it));
-      connect(aAction, SIGNAL(triggered()), this, SLOT(syncedFileClicked()));
-      mCurrentSyncedFilesActions.push_back(aAction);
+      action->setText(tr("None"));
     }
-    mpLastSyncedMenu->addActions(mCurrentSyncedFilesActions);
+    action->setVisible(idx == 0 || static_cast<std::size_t>(idx) < folders.size());
   }
 }
 
 
+//------------------------------------------------------------------------------------//
+
+void Window::createLastSyncedMenu()
+{
+  mpLastSyncedMenuModel->update(mLastSyncedFiles);
+}
+
+
+//------------------------------------------------------------------------------------//
+
+QString Window::syncedFileKey(const DateFolderFile& file)
+{
+  return std::get<1>(file) + '\n' + std::get<2>(file);
+}
+
+
 //------------------------------------------------------------------------------------//
 
 void Window::createTrayIcon()
@@ -693,9 +772,37 @@ void Window::createTrayIcon()
       mpLastSyncedMenu == nullptr)
   {
     mpTrayIconMenu = new QMenu(this);
+    using namespace qst::utilities;
     mpFolderMenu = new QMenu(tr("Folders"), this);
+    mpFolderMenuModel.reset(new qst::menu::KeyedMenu<FolderNameFullPath>(mpFolderMenu,
+      [](const FolderNameFullPath& folder)
+      {
+        return folder.first;
+      },
+      [](QAction* action, const FolderNameFullPath& folder)
+      {
+        action->setText(getFullCleanFileName(folder.second));
+      }));
+    connect(mpFolderMenu, &QMenu::triggered, this, &Window::folderClicked);
     mpLastSyncedMenu = new QMenu(tr("Last Synced"), this);
-    mpLastSyncedMenu->addAction(tr("None"));
+    mpLastSyncedMenuModel.reset(new qst::menu::KeyedMenu<DateFolderFile>(
+      mpLastSyncedMenu, &Window::syncedFileKey,
+      [](QAction* action, const DateFolderFile& file)
+      {
+        action->setText(getCleanFileName(std::get<2>(file)));
+        // 4th item of tuple is file-erased-bool
+        action->setDisabled(std::get<3>(file));
+      }, tr("None")));
+    connect(mpLastSyncedMenu, &QMenu::triggered, this, &Window::syncedFileClicked);
+    mpTopFoldersMenu = new QMenu(tr("Top Folders"), this);
+    for (int idx = 0; idx < kNumTopFolders; ++idx)
+    {
+      QAction *aAction = new QAction(tr("None"), this);
+      aAction->setDisabled(true);
+      aAction->setVisible(idx == 0);
+      mTopFoldersActions.push_back(aAction);
+    }
+    mpTopFoldersMenu->addActions(mTopFoldersActions);
   }
   mpTrayIconMenu->clear();
   mpTrayIconMenu->addAction(mpConnectedState);
@@ -708,6 +815,7 @@ void Window::createTrayIcon()
   mpTrayIconMenu->addSeparator();
 
   mpTrayIconMenu->addMenu(mpFolderMenu);
+  mpTrayIconMenu->addMenu(mpTopFoldersMenu);
   mpTrayIconMenu->addMenu(mpLastSyncedMenu);
   mpTrayIconMenu->addSeparator();
   mpTrayIconMenu->addAction(mpShowWebViewAction);
@@ -800,32 +908,59 @@ void Window::validateSSLSupport()
 
 void Window::onStartAnimation(const bool animate)
 {
-  QString iconToAnimate = mIconMonochrome ? tr(kAnimatedIconSet.back().c_str())
-    : tr(kAnimatedIconSet.front().c_str());
-  if (!animate || !mShouldAnimateIcon)
+  // Starts with the first report of activity, but only stops once there
+  // was none for kAnimationHoldMs, so short pauses between transfers do
+  // not make it flap. A started cycle is always played to its end.
+  if (animate && mShouldAnimateIcon)
   {
-    mShouldStopAnimation = true;
+    mLastNetworkActivity.start();
+    mShouldStopAnimation = false;
+    if (!mAnimationTimer.isActive())
+    {
+      const auto& animation = currentAnimation();
+      if (animation.frames.isEmpty())
+      {
+        return;
+      }
+      mAnimationFrame = -1;
+      mAnimationTimer.start(animation.frameDelayMs);
+    }
   }
-  else if (animate && mShouldAnimateIcon
-    && mpAnimatedIconMovie->state() != QMovie::Running)
+  else if (!mShouldAnimateIcon || !mLastNetworkActivity.isValid() ||
+    mLastNetworkActivity.hasExpired(kAnimationHoldMs))
   {
-    mShouldStopAnimation = false;
-    mpAnimatedIconMovie->setFileName(iconToAnimate);
-    mpAnimatedIconMovie->start();
+    mShouldStopAnimation = true;
   }
 }
 
 
+//------------------------------------------------------------------------------------//
+
+auto Window::currentAnimation() -> const qst::icons::TrayIconCache::Animation&
+{
+  return mTrayIcons.animation(mIconMonochrome ? kAnimatedIconSet.back().c_str()
+    : kAnimatedIconSet.front().c_str());
+}
+
+
 //------------------------------------------------------------------------------------//
 
 void Window::onUpdateIcon()
 {
-  if (mShouldStopAnimation && mpAnimatedIconMovie->currentFrameNumber() ==
-    mpAnimatedIconMovie->frameCount() - 1)
+  // the frames are decoded already, a tick only hands one to the tray
+  const auto& frames = currentAnimation().frames;
+  if (frames.isEmpty())
+  {
+    mAnimationTimer.stop();
+    return;
+  }
+  mAnimationFrame = (mAnimationFrame + 1) % frames.size();
+  mpTrayIcon->setIcon(frames[mAnimationFrame]);
+  if (mShouldStopAnimation && mAnimationFrame == frames.size() - 1)
   {
-    mpAnimatedIconMovie->stop();
+    mAnimationTimer.stop();
+    setIcon(mLastIconIndex, true);
   }
-  mpTrayIcon->setIcon(QIcon(QPixmap::fromImage(mpAnimatedIconMovie->currentImage())));
 }
 
 